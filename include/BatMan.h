@@ -2,8 +2,13 @@
 #define BATMAN_H
 
 #include <stdint.h>
+#include <atomic>
 #include "Param.h"
+#include "PackData.h"
 #include "driver/spi_master.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 
 // ESP32 SPI Configuration
@@ -15,6 +20,46 @@
 #define BMB_SCK         GPIO_NUM_15  // Keep original BMB pins
 #define BMB_CS          GPIO_NUM_22  // Keep original BMB pins
 
+// Register read frame: 2 command words (4 bytes) followed by 72 response bytes (9 bytes x 8 chips)
+#define BMB_FRAME_BYTES 76
+#define BMB_REG_FIRST   0x47         // First register with a timing slot (Read A)
+#define BMB_REG_COUNT   10           // 0x47..0x50
+
+// Queued transaction mode
+#define BMB_MAX_OPS     20           // Bus steps in one acquisition state (burst scan is the longest)
+#define BMB_QUEUE_DEPTH 32           // SPI transactions in flight for one state (ops + gaps)
+#define BMB_QUEUE_ARENA 2048         // DMA bytes shared by all queued transactions of one segment
+#define BMB_QUEUE_GAP_MAX_US 500     // Longer gaps end a queued segment and are timed by stepTimer
+
+// Burst scan: settle time between Snap and the first cell register read (ADC conversion of all cells)
+#define BMB_SNAP_SETTLE_US 2400
+
+// Scheduled scan: bus budget of one slot, in register-frame equivalents (a cell scan is 5)
+#define BMB_SLOT_BUDGET 8
+
+// Response PEC: 0 = count errors only, 1 = drop failed blocks and re-read. Count-only until the
+// reply block layout in BmbCrc.h is confirmed against a captured BMB response.
+#define BMB_PEC_CHECK_DEFAULT 0
+
+// Balancing bitmap as text: 108 cells = 27 hex digits + terminator
+#define BMB_BALANCE_HEX_LEN 28
+
+// BMB SPI clock calibration: steps tried from 1 MHz upward, one step of margin below the fastest
+// that passes, and a step down whenever the PEC error rate over a window gets too high. A step
+// passes when the cfg register reads back the same as at 1 MHz; with the PEC check on, cells, aux
+// and cfg must also pass PEC. The error-rate back-off only runs with the PEC check on.
+#define BMB_SPI_AUTOTUNE         1
+#define BMB_SPI_CAL_READS        8      // reads per register per step
+#define BMB_SPI_WINDOW_BLOCKS    512    // PEC blocks per error-rate window
+#define BMB_SPI_BACKOFF_PERMILLE 5      // step down above 0.5% bad blocks
+
+// Acquisition task
+#define BMB_TASK_CORE           0     // Arduino loop() runs on core 1
+#define BMB_TASK_PRIORITY       3
+#define BMB_TASK_STACK          6144
+#define BMB_TASK_MIN_PERIOD_MS  5     // Yield between full 8-state cycles
+#define BMB_REPORT_INTERVAL_MS  1000  // Serial summaries from the task are rate limited
+
 
 /* Tesla HVC Batman Debug Header Pinout
 
@@ -31,31 +76,115 @@ static inline uint16_t rev16(uint16_t x) {
     return ((x & 0xFF00) >> 8) | ((x & 0x00FF) << 8);
 }
 
+// One step of a BMB bus sequence. Each acquisition state is described as a list of these,
+// which is then either executed in place or submitted to the SPI transaction queue.
+enum BmbOpType : uint8_t {
+    BMB_OP_WAKE,
+    BMB_OP_MUTE,
+    BMB_OP_UNMUTE,
+    BMB_OP_SNAP,
+    BMB_OP_READ,      // GetData(reqID)
+    BMB_OP_TEMP,      // GetTempData()
+    BMB_OP_WRITECFG,
+    BMB_OP_GAP        // Idle bus time with CS high (queued mode only)
+};
+
+struct BmbOp {
+    BmbOpType type;
+    uint8_t reqID;
+    uint16_t gapUs;   // Inter-frame gap after this step
+};
+
+// Register groups of the scheduled scan. Period and priority of each come from the
+// Scan*Ms / Scan*Pri parameters so the schedule can be changed over the param API.
+enum BmbScanGroup : uint8_t {
+    BMB_SCAN_CELLS,   // Snap + Read A-E
+    BMB_SCAN_CHIPV,   // 0x4C chip total V
+    BMB_SCAN_AUX,     // 0x4D 5V rail
+    BMB_SCAN_CFG,     // 0x50 read + balance cfg write
+    BMB_SCAN_TEMP,    // 0x0E1B temps
+    BMB_SCAN_STATUS,  // 0x4F
+    BMB_SCAN_GROUPS
+};
+
+enum BmbScanMode : uint8_t {
+    BMB_SCAN_STAGED,     // states 0-6, low power
+    BMB_SCAN_BURST,      // everything every cycle
+    BMB_SCAN_SCHEDULED   // per-group periods packed into bus slots
+};
+
+struct BmbScanItem {
+    uint16_t periodMs;
+    uint8_t priority;    // higher runs first when a slot is full
+    uint8_t cost;        // register frames
+    uint32_t lastRunMs;
+    uint32_t runs;
+};
+
+// A queued SPI transaction and the step it belongs to
+struct BmbQueued {
+    spi_transaction_t t;
+    BmbOp op;
+    bool cs;                    // Frame is wrapped in CS low/high by the pre/post callbacks
+    uint16_t bytes;
+    volatile uint32_t doneUs;   // Completion time stamped in the post callback
+};
+
+// Complete, consistent pack state published by the acquisition side once per full cycle
+struct PackSnapshot {
+    uint32_t timestampMs;       // millis() at publish
+    uint32_t cycle;             // Full acquisition cycles completed
+    uint16_t Voltage[8][15];
+    uint16_t Temps[8];
+    uint16_t Temp1[8];
+    uint16_t Temp2[8];
+    uint16_t Volts5v[8];
+    uint16_t ChipV[8];
+    uint16_t CellBalCmd[8];     // Balance bitmap per chip
+    float CellVMax;
+    float CellVMin;
+    PackStats stats;            // From the last measurement-phase cell scan
+    SyncedMeasurement sync;     // Current matched to the Snap behind Voltage[][]
+    uint8_t balancePhase;       // Config phase at the Snap; 0 = no balance current in the readings
+    bool cellsFresh;            // Voltage[][] was read in this cycle, not carried over
+};
+
 class BATMan {
 public:
     BATMan();
     void BatStart();
     void loop();
+    void service();
+    bool startTask();
+    bool taskRunning() const { return acqTask != NULL; }
     void StateMachine();
+
+    const PackStats &getPackStats() const { return view.stats; }
     void IdleWake();
     void GetData(uint8_t ReqID);
+    void DecodeData(uint8_t ReqID);
     void WriteCfg();
+    void BuildCfgFrame(uint16_t cfgwrt[25]);
     void GetTempData();
+    void DecodeTempData(const uint8_t *rx);
     void WakeUP();
     void Generic_Send_Once(uint16_t Command[], uint8_t len);
     void upDateCellVolts();
+    uint16_t balanceThreshold() const;
     void upDateAuxVolts();
     void upDateTemps();
-    void updateIndividualCellVoltageParameters(void);  // Update individual cell voltage parameters during all phases
-    uint8_t calcCRC(uint8_t *inData, uint8_t Length);
-    void crc14_bytes(uint8_t len_B, uint8_t *bytes, uint16_t *crcP);
-    void crc14_bits(uint8_t len_b, uint8_t inB, uint16_t *crcP);
-    uint16_t spi_xfer(spi_host_device_t host, uint16_t data);
+    uint16_t spi_word(uint16_t data);
+    void spi_frame(const uint8_t *tx, uint8_t *rx, uint16_t len);
     bool checkSPIConnection();
 
+    // Reader side: copy the latest published snapshot into the view used by the getters below.
+    // Never blocks; returns false and keeps the previous view if the writer kept it busy.
+    bool refreshView();
+    const PackSnapshot &getView() const { return view; }
+
     // New getter methods for display
-    float getMinVoltage() const { return CellVMin; }
-    float getMaxVoltage() const { return CellVMax; }
+    float getMinVoltage() const { return view.CellVMin; }
+    float getMaxVoltage() const { return view.CellVMax; }
     
     // Helper method to get hardware register position for a cell
     struct CellPosition {
@@ -64,42 +193,41 @@ public:
         bool valid;
     };
     
+    // Both directions are table lookups into the cell map, which refreshView() rebuilds only
+    // when the set of present cells (Voltage > 10) changes
     CellPosition getCellHardwarePosition(int sequentialCellNum) const {
         CellPosition pos = {0, 0, false};
-        int cellCount = 0;
-        
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 15; j++) {
-                if (Voltage[i][j] > 10) { // Cell is present
-                    cellCount++;
-                    if (cellCount == sequentialCellNum) {
-                        pos.chip = i;
-                        pos.register_pos = j;
-                        pos.valid = true;
-                        return pos;
-                    }
-                }
-            }
+        if (sequentialCellNum >= 1 && sequentialCellNum <= cellMap.cells) {
+            pos.chip = cellMap.slotOfCell[sequentialCellNum] >> 4;
+            pos.register_pos = cellMap.slotOfCell[sequentialCellNum] & 0x0F;
+            pos.valid = true;
         }
         return pos;
     }
     
     // Get sequential cell number from hardware position
     int getSequentialCellNumber(int chip, int register_pos) const {
-        int cellCount = 0;
-        
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 15; j++) {
-                if (Voltage[i][j] > 10) { // Cell is present
-                    cellCount++;
-                    if (i == chip && j == register_pos) {
-                        return cellCount;
-                    }
-                }
-            }
+        if (chip < 0 || chip >= 8 || register_pos < 0 || register_pos >= 15) {
+            return 0;
         }
-        return 0;
+        return cellMap.cellOfSlot[chip][register_pos];
+    }
+
+    uint8_t getCellsPresent() const { return cellMap.cells; }
+
+    // Voltages of the present cells in sequential order (cell 1 first); returns how many
+    uint8_t getCellVoltages(uint16_t *mv, uint8_t max) const {
+        uint8_t n = cellMap.cells < max ? cellMap.cells : max;
+        for (uint8_t cell = 1; cell <= n; cell++) {
+            uint8_t slot = cellMap.slotOfCell[cell];
+            mv[cell - 1] = view.Voltage[slot >> 4][slot & 0x0F];
+        }
+        return n;
     }
+    uint32_t getSnapshotCycle() const { return view.cycle; }
+    uint32_t getSnapshotTime() const { return view.timestampMs; }
+    uint8_t getSnapshotBalancePhase() const { return view.balancePhase; }
+    bool getSnapshotCellsFresh() const { return view.cellsFresh; }
     
     // Debug method to print hardware register mapping
     void printHardwareMapping() const;
@@ -108,46 +236,186 @@ public:
     static void setRegisterDebug(bool enable) { _registerDebugEnabled = enable; }
     static bool getRegisterDebug() { return _registerDebugEnabled; }
 
-    int getMinCell() const {
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 15; j++) {
-                if (Voltage[i][j] == CellVMin) {
-                    return getSequentialCellNumber(i, j);
-                }
-            }
-        }
-        return 0;
-    }
-    int getMaxCell() const {
-        for (int i = 0; i < 8; i++) {
-            for (int j = 0; j < 15; j++) {
-                if (Voltage[i][j] == CellVMax) {
-                    return getSequentialCellNumber(i, j);
+    // Register reads: one DMA transaction per frame (default) or the legacy word-by-word path
+    void setDmaReads(bool enable) { dmaReads = enable && dmaTx != NULL; }
+    bool getDmaReads() const { return dmaReads; }
+    void printReadTiming() const;
+
+    // Response PEC: each chip's block in 0x47-0x50 frames is CRC-14 checked. On = failed blocks are
+    // dropped and the register is re-read once straight away. Off (default) = count errors, keep data.
+    void setPecCheck(bool enable) { pecCheck = enable; }
+    bool getPecCheck() const { return pecCheck; }
+    void printPecStats() const;
+    void clearPecStats();
+
+    // SPI clock: calibration and manual changes are requested here and carried out by the
+    // acquisition side between cycles, when the bus is idle
+    void requestSpiCalibration() { spiCalRequest = true; }
+    void requestSpiClock(uint32_t hz) { spiClockRequest = hz; }
+    uint32_t getSpiClock() const { return spiClockHz; }
+    void printSpiClock() const;
+
+    // Queued mode: a whole state's command list is submitted at once and decoded as results complete
+    void setQueuedMode(bool enable) { queuedMode = enable && queueTx != NULL; }
+    bool getQueuedMode() const { return queuedMode; }
+    void printQueueTimeline() const;
+
+    // Scan mode (ScanMode param): staged (default, low power) spreads the work over states 0-6,
+    // burst does a full pack scan per cycle, scheduled reads each register group at its own rate.
+    void setBurstMode(bool enable);
+    bool getBurstMode() const { return scanMode == BMB_SCAN_BURST; }
+    uint32_t getSnapLatencyUs() const { return SnapLatencyUs; }
+
+    // Supplies the pack current at an esp_timer instant (CurrentSampler::currentAt). Called from
+    // publishSnapshot on the acquisition side, so it must be safe from any task.
+    typedef bool (*CurrentSource)(uint32_t timeUs, float &amps, uint32_t &errUs);
+    void setCurrentSource(CurrentSource source) { currentSource = source; }
+    // Voltages in the current view and this record come from the same snapshot
+    const SyncedMeasurement &getSyncedMeasurement() const { return view.sync; }
+    void printSchedule() const;
+
+    int getMinCell() const { return view.stats.minCell; }
+    int getMaxCell() const { return view.stats.maxCell; }
+
+    // Balancing state for display: one bit per hardware cell slot. Bit reg of balance[chip] is
+    // set when that cell is above the balance threshold; present[] marks the slots that hold a
+    // cell, which is what turns (chip, reg) into a sequential cell number.
+    struct BalanceMap {
+        uint16_t balance[8];
+        uint16_t present[8];
+        uint8_t totalCells;
+        uint8_t balancingCells;
+
+        struct Cursor {
+            uint8_t chip = 0;
+            uint8_t reg = 0;
+            uint8_t cell = 0;
+        };
+
+        // Next balancing cell as a sequential cell number (1-based), 0 when there are no more
+        int next(Cursor &c) const {
+            for (; c.chip < 8; c.chip++, c.reg = 0) {
+                for (; c.reg < 15; c.reg++) {
+                    uint16_t bit = 1 << c.reg;
+                    if (!(present[c.chip] & bit)) continue;
+                    c.cell++;
+                    if (balance[c.chip] & bit) {
+                        c.reg++;
+                        return c.cell;
+                    }
                 }
             }
+            return 0;
         }
-        return 0;
-    }
 
-    // Get balancing information for display
-    struct BalancingInfo {
-        int totalCells;
-        int balancingCells;
-        int balancingCellNumbers[108]; // Array to store cell numbers being balanced
+        // Comma-separated balancing cell numbers ("3,17,42"), returns the length written
+        size_t formatList(char *buf, size_t len) const;
+        // Bitmap over sequential cells as hex, most significant first: the last digit holds
+        // cells 1-4 (bit 0 = cell 1). Needs BMB_BALANCE_HEX_LEN bytes.
+        size_t formatHex(char *buf, size_t len) const;
     };
-    
-    BalancingInfo getBalancingInfo() const;
+
+    void getBalanceMap(BalanceMap &map) const;
     
     // Get voltage from specific chip and register position
     uint16_t getVoltage(int chip, int register_pos) const {
         if (chip >= 0 && chip < 8 && register_pos >= 0 && register_pos < 15) {
-            return Voltage[chip][register_pos];
+            return view.Voltage[chip][register_pos];
         }
         return 0;
     }
 
 private:
+    void addOp(BmbOpType type, uint8_t reqID = 0, uint16_t gapUs = 0);
+    void addIdleWake(uint16_t extraGapUs);
+    void buildStateOps(uint16_t state);
+    void buildBurstOps();
+    void loadSchedule();
+    void buildScheduledOps();
+    void executeOps();
+    void startOps();
+    bool stepOps();
+    void queueOps(uint8_t first);
+    uint16_t segmentBytes(uint8_t first, uint32_t hz, uint8_t &end, uint8_t &count) const;
+    static void stepTimerCb(void *arg);
+    bool pollQueue(TickType_t wait = 0);
+    void waitOps();
+    void publishSnapshot();
+    static void taskMain(void *arg);
+
     spi_device_handle_t spi_dev;
+    uint8_t *dmaTx;                      // DMA-capable command frame buffer
+    uint8_t *dmaRx;                      // DMA-capable response frame buffer
+    bool dmaReads;
+    uint16_t pecOkMask(uint8_t ReqID) const;
+    uint16_t checkPec(uint8_t ReqID);
+    void readFrame(uint8_t ReqID);
+    esp_err_t addSpiDevice();
+    bool setSpiClock(uint32_t hz);
+    bool spiClockStepOk(uint8_t step, const uint8_t *cfgRef);
+    bool listFits(uint32_t hz) const;
+    uint8_t queueStepLimit();
+    void calibrateSpiClock();
+    void monitorSpiErrors();
+    void handleSpiRequests();
+    void rereadFailed();
+    bool pecCheck;
+    bool inReread;
+    uint16_t rereadMask;                     // bit (ReqID - BMB_REG_FIRST) per register to re-read
+    uint16_t PecErrors[8][BMB_REG_COUNT];    // per chip, per register
+    uint32_t PecBlocks;                      // blocks checked
+    uint32_t PecRereads;
+    uint32_t PecRecovered;                   // re-reads that came back clean
+    uint32_t PecFailures;                    // all failed blocks, for the SPI error-rate monitor
+    uint32_t ReadTimeUs[2][BMB_REG_COUNT];  // Last GetData() time per ReqID, [0]=word-by-word [1]=DMA frame
+    BmbOp ops[BMB_MAX_OPS];              // Command list of the current state
+    uint8_t opCount;
+    BmbQueued queued[BMB_QUEUE_DEPTH];
+    uint8_t queuedCount;
+    uint8_t queuePending;                // Queued transactions whose results are not yet decoded
+    uint8_t *queueTx;                    // DMA arenas for queued transactions
+    uint8_t *queueRx;
+    uint32_t queueStartUs;
+    bool queuedMode;
+    bool queueResume;                    // stepTimer is timing a long gap; the rest of the list is queued after it
+    uint32_t QueueOverflows;             // Segments that did not fit the arena and ran unqueued
+    uint32_t spiClockHz;
+    uint8_t spiStep;                         // index into the clock step table
+    uint8_t spiCalStep;                      // fastest step that passed the last calibration
+    volatile bool spiCalRequest;
+    volatile uint32_t spiClockRequest;
+    uint32_t spiWindowBlocks;
+    uint32_t spiWindowFailures;
+    uint32_t SpiBackoffs;
+    esp_timer_handle_t stepTimer;        // One-shot timer that ends each inter-frame gap
+    uint8_t opIndex;                     // Next step of the current command list
+    bool stepsPending;
+    volatile bool stepDue;               // Set by stepTimer when the current gap has elapsed
+    uint32_t waitAccumUs;                // Gap time of the cycle in progress
+    uint32_t WaitSavedUs;                // Busy-wait time removed from the last full cycle
+    TaskHandle_t acqTask;
+    std::atomic<uint32_t> snapSeq;       // Seqlock: odd while the writer is updating published
+    PackSnapshot published;
+    PackSnapshot view;
+    CellMap cellMap;                     // For view, rebuilt by refreshView() on topology change
+    uint32_t cycleCount;
+    bool reportDue;                      // Print serial summaries this cycle
+    uint32_t lastReportMs;
+    uint8_t scanMode;
+    BmbScanItem scan[BMB_SCAN_GROUPS];
+    uint32_t slotCount;
+    uint32_t scanStartMs;
+    uint32_t snapUs;                     // When the last Snap command left the bus
+    uint8_t cfgPhase;                    // Balance phase of the config last sent to the chips
+    uint8_t snapPhase;                   // cfgPhase in effect when the last Snap was taken
+    uint32_t cellsFreshUs;               // When the last cell register (Read E) was decoded
+    uint32_t publishedCellsUs;           // cellsFreshUs of the last published snapshot
+    uint32_t SnapLatencyUs;              // Snap -> fresh Voltage[][] for the last cycle
+    CurrentSource currentSource;
+    uint32_t alignCount;                 // Snapshots matched with a current sample
+    uint32_t alignMisses;                // ... and those without one
+    uint64_t alignSumUs;
+    uint32_t alignMaxUs;
     static bool _registerDebugEnabled;  // Debug flag for detailed register output
     uint8_t ChipNum;
     uint16_t Voltage[8][15];
@@ -155,11 +423,14 @@ private:
     uint16_t Temps[8];
     uint16_t Temp1[8];
     uint16_t Temp2[8];
+    float Temp1C[8];                     // Temp1/Temp2 converted to C by upDateTemps
+    float Temp2C[8];
     uint16_t Volts5v[8];
     uint16_t ChipV[8];
     uint16_t Cfg[8][2];
     float CellVMax;
     float CellVMin;
+    PackStats cellStats;                 // Acquisition side, from upDateCellVolts
     float TempMax;
     float TempMin;
     bool BalanceFlag;
@@ -172,7 +443,6 @@ private:
     uint16_t SendDelay;
     uint32_t lasttime;
     uint8_t BalancePhase;  // 0=measurement only (no balancing), 1=even cells, 2=odd cells
-    uint16_t LastCellBalancing;  // Preserve balancing count across phases
     float Cell1start;
     float Cell2start;
 };
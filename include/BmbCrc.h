@@ -0,0 +1,161 @@
+#ifndef BMB_CRC_H
+#define BMB_CRC_H
+
+#include <stdint.h>
+
+// BMB (LTC6813-style) link CRCs, generated at compile time.
+//   Command PEC: CRC-8, poly 0x2F, init 0x10
+//   Data PEC:    CRC-14, poly 0x025B, init 0x10, 4 data bytes followed by 2 (masked) bits
+// Every frame below is checked against the logic-analyzer capture in context/bman.csv
+// by the static_asserts at the end of this file.
+
+#define BMB_CRC8_POLY   0x2F
+#define BMB_CRC8_INIT   0x10
+#define crcPolyBmData   0x025b
+#define BMB_CRC14_INIT  0x0010
+
+struct BmbCrc8Table {
+    uint8_t v[256];
+    constexpr BmbCrc8Table() : v() {
+        for (int i = 0; i < 256; i++) {
+            uint8_t c = (uint8_t)i;
+            for (int b = 0; b < 8; b++) {
+                c = (c & 0x80) ? (uint8_t)((c << 1) ^ BMB_CRC8_POLY) : (uint8_t)(c << 1);
+            }
+            v[i] = c;
+        }
+    }
+};
+
+struct BmbCrc14Table {
+    uint16_t v[256];
+    constexpr BmbCrc14Table() : v() {
+        for (int i = 0; i < 256; i++) {
+            uint16_t c = (uint16_t)(i << 6);
+            for (int b = 0; b < 8; b++) {
+                c = (c & 0x2000) ? (uint16_t)((c << 1) ^ crcPolyBmData) : (uint16_t)(c << 1);
+            }
+            v[i] = c & 0x3fff;
+        }
+    }
+};
+
+static constexpr BmbCrc8Table bmbCrc8Table{};
+static constexpr BmbCrc14Table bmbCrc14Table{};
+
+static constexpr uint8_t bmbCrc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = BMB_CRC8_INIT;
+    for (uint8_t i = 0; i < len; i++) {
+        crc = bmbCrc8Table.v[crc ^ data[i]];
+    }
+    return crc;
+}
+
+// Two-byte command (register read): CMD, ADDR -> PEC
+static constexpr uint8_t bmbCrc8Pair(uint8_t cmd, uint8_t addr) {
+    return bmbCrc8Table.v[bmbCrc8Table.v[BMB_CRC8_INIT ^ cmd] ^ addr];
+}
+
+// Single-byte command word as sent on the wire: CMD in the high byte, PEC in the low byte
+static constexpr uint16_t bmbCmdWord(uint8_t cmd) {
+    return (uint16_t)((cmd << 8) | bmbCrc8Table.v[BMB_CRC8_INIT ^ cmd]);
+}
+
+static constexpr uint16_t bmbCrc14Bytes(uint16_t crc, const uint8_t *bytes, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        uint8_t pos = (uint8_t)((crc >> 6) ^ bytes[i]);
+        crc = (uint16_t)((0x3fff & (crc << 8)) ^ bmbCrc14Table.v[pos]);
+    }
+    return crc;
+}
+
+// Trailing partial byte. Only the top len_b bits of inB take part, as in the original crc14_bits.
+static constexpr uint16_t bmbCrc14Bits(uint16_t crc, uint8_t len_b, uint8_t inB) {
+    inB = inB & (uint8_t)(0xFF00 >> len_b);   // Mask out the bite we don't care about
+    crc ^= (uint16_t)(inB << 6); /* move byte into MSB of 14bit CRC */
+    while (len_b--) {
+        /* test for MSB = bit 13 */
+        crc = (crc & 0x2000) ? (uint16_t)((crc << 1) ^ crcPolyBmData) : (uint16_t)(crc << 1);
+    }
+    return crc & 0x3fff;
+}
+
+// PEC of one chip's 4-byte config write block
+static constexpr uint16_t bmbCfgPec(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    const uint8_t data[4] = {b0, b1, b2, b3};
+    return bmbCrc14Bits(bmbCrc14Bytes(BMB_CRC14_INIT, data, 4), 2, 2);
+}
+
+// Response block of one chip: dataLen data bytes, then the PEC word MSB first, then one more byte
+// (BMB_BLOCK_TAIL) that is neither data nor PEC and is not covered. The top two bits of the PEC
+// word are fed through the CRC like the trailing bits of a write block; the low 14 bits carry the
+// CRC itself. UNVERIFIED: this layout is modelled on the write path because the capture only has
+// the master side of the bus. Until a captured BMB reply is checked below, the PEC check runs in
+// count-only mode (BMB_PEC_CHECK_DEFAULT).
+#define BMB_BLOCK_PEC  2
+#define BMB_BLOCK_TAIL 1
+static constexpr uint8_t bmbBlockStride(uint8_t dataLen) {
+    return (uint8_t)(dataLen + BMB_BLOCK_PEC + BMB_BLOCK_TAIL);
+}
+static_assert(bmbBlockStride(6) == 9 && bmbBlockStride(4) == 7, "Chip block strides of the 72-byte response");
+
+static constexpr bool bmbBlockPecOk(const uint8_t *block, uint8_t dataLen) {
+    uint16_t pec = (uint16_t)((block[dataLen] << 8) | block[dataLen + 1]);
+    uint16_t crc = bmbCrc14Bits(bmbCrc14Bytes(BMB_CRC14_INIT, block, dataLen), 2, block[dataLen]);
+    return crc == (pec & 0x3fff);
+}
+
+// Fully formed command frames, indexed for the register reads by (ReqID - BMB_CMD_READ_FIRST)
+#define BMB_CMD_READ_FIRST 0x47
+#define BMB_CMD_READ_COUNT 10        // 0x47..0x50
+#define BMB_CMD_READ_ADDR  0x00      // Address byte this firmware sends (Tesla's controller uses 0xA1)
+
+struct BmbCmdFrames {
+    uint16_t read[BMB_CMD_READ_COUNT][2];
+    uint16_t snap, mute, unmute, wakeUp, reqTemp, writeCfg;
+    constexpr BmbCmdFrames() : read(), snap(bmbCmdWord(0x2B)), mute(bmbCmdWord(0x20)),
+        unmute(bmbCmdWord(0x21)), wakeUp(bmbCmdWord(0x2A)), reqTemp(bmbCmdWord(0x0E)),
+        writeCfg(bmbCmdWord(0x11)) {
+        for (int i = 0; i < BMB_CMD_READ_COUNT; i++) {
+            uint8_t reg = (uint8_t)(BMB_CMD_READ_FIRST + i);
+            read[i][0] = (uint16_t)((reg << 8) | BMB_CMD_READ_ADDR);
+            read[i][1] = (uint16_t)(bmbCrc8Pair(reg, BMB_CMD_READ_ADDR) << 8);
+        }
+    }
+};
+
+static constexpr BmbCmdFrames bmbFrames{};
+
+// --- Checks against context/bman.csv (master side of the bus) ---
+// Register reads as captured: "<reg> A1 <pec> 00 ..."
+static_assert(bmbCrc8Pair(0x47, 0xA1) == 0xCF, "Read A PEC");
+static_assert(bmbCrc8Pair(0x48, 0xA1) == 0x8B, "Read B PEC");
+static_assert(bmbCrc8Pair(0x49, 0xA1) == 0x62, "Read C PEC");
+static_assert(bmbCrc8Pair(0x4A, 0xA1) == 0x76, "Read D PEC");
+static_assert(bmbCrc8Pair(0x4B, 0xA1) == 0x9F, "Read E PEC");
+static_assert(bmbCrc8Pair(0x4C, 0xA1) == 0x5E, "Read F PEC");
+static_assert(bmbCrc8Pair(0x4D, 0xA1) == 0xB7, "Aux A PEC");
+static_assert(bmbCrc8Pair(0x4E, 0xA1) == 0xA3, "Aux B PEC");
+static_assert(bmbCrc8Pair(0x4F, 0xA1) == 0x4A, "Status PEC");
+static_assert(bmbCrc8Pair(0x50, 0xA1) == 0x2B, "Cfg read PEC");
+// Single-byte commands as captured
+static_assert(bmbFrames.snap == 0x2BFB, "Snap");
+static_assert(bmbFrames.unmute == 0x21F2, "Unmute");
+static_assert(bmbFrames.writeCfg == 0x112F, "Write cfg");
+static_assert(bmbCmdWord(0x14) == 0x14BC && bmbCmdWord(0x15) == 0x1593, "Write cfg B/C");
+static_assert(bmbCmdWord(0x33) == 0x3302, "0x33 command");
+// Config write blocks as captured: "03 80 00 00 2B 06" and "00 00 00 00 07 AA"
+static_assert(bmbCfgPec(0x03, 0x80, 0x00, 0x00) == 0x2B06, "Cfg block PEC");
+static_assert(bmbCfgPec(0x00, 0x00, 0x00, 0x00) == 0x07AA, "Cfg block PEC (zero)");
+// The write block above run through the response checker. This only shows the checker matches
+// the write-side PEC; it says nothing about the reply layout (see bmbBlockPecOk).
+static constexpr uint8_t bmbPecSample[6] = {0x03, 0x80, 0x00, 0x00, 0x2B, 0x06};
+static_assert(bmbBlockPecOk(bmbPecSample, 4), "Response PEC check");
+// Not in the capture: the words this firmware has always sent
+static_assert(bmbFrames.wakeUp == 0x2AD4, "WakeUp");
+static_assert(bmbFrames.mute == 0x20DD, "Mute");
+static_assert(bmbFrames.reqTemp == 0x0E1B, "Temp request");
+static_assert(bmbFrames.read[0][1] == 0x7000 && bmbFrames.read[5][1] == 0xE100 &&
+              bmbFrames.read[9][1] == 0x9400, "Read frames with address 0x00");
+
+#endif // BMB_CRC_H
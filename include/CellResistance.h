@@ -0,0 +1,65 @@
+#ifndef CELL_RESISTANCE_H
+#define CELL_RESISTANCE_H
+
+#include <stdint.h>
+#include "PackData.h"
+
+class HardwareSerial;
+
+// Online internal resistance per cell from load steps. Between two snapshots taken close
+// together the open-circuit voltage has barely moved, so each cell's voltage change is its
+// resistance times the current change: dV(mV) = R(mOhm) * dI(A). A scalar recursive least
+// squares fit per cell tracks R; the forgetting factor lets it follow temperature and ageing.
+#define RINT_CELLS            108     // r1..r108
+#define RINT_MIN_STEP_A       10.0f   // Smaller current changes are mostly quantisation noise
+#define RINT_MAX_ALIGN_US     2000    // Both snapshots' current this close to their Snap
+#define RINT_MAX_GAP_MS       2000    // Reference older than this: OCV may have moved, start over
+#define RINT_FORGET           0.99f   // RLS forgetting factor, roughly the last 100 steps
+#define RINT_P0               1.0f    // Initial covariance, (mOhm/A)^2
+#define RINT_MIN_UPDATES      3       // Steps seen before a cell's estimate is published
+
+class CellResistance {
+public:
+    CellResistance();
+
+    // Sign convention as the coulomb counter; a change drops the estimates
+    void configure(bool invert);
+    // One snapshot: cells present in sequential order (mV) and the current at their Snap.
+    // Call once per new snapshot; timeMs is when it was taken.
+    void update(const uint16_t *mv, uint8_t cells, const SyncedMeasurement &sync, uint32_t timeMs);
+    void reset();
+
+    // Write r1..r108, Rmax, RmaxCell and Ravg
+    void publish() const;
+
+    float resistance(uint8_t cell) const;   // mOhm, cell from 1; 0 until published
+    uint32_t stepsApplied() const { return steps; }
+    uint32_t misalignedCount() const { return misaligned; }
+    uint32_t staleCount() const { return stale; }
+#ifdef ARDUINO
+    void printStatus(HardwareSerial &serialPort) const;
+#endif
+
+private:
+    struct Cell {
+        float r;            // mOhm
+        float p;            // Covariance
+        uint16_t refMv;     // Voltage at the reference snapshot
+        uint8_t updates;    // Saturates at 255
+    };
+
+    Cell cell[RINT_CELLS];
+    uint8_t cellCount;
+    bool invert;
+    bool haveRef;
+    float refCurrent;       // A at the reference snapshot, sign applied
+    uint32_t refMs;
+
+    uint32_t steps;         // Updates applied
+    uint32_t smallSteps;    // Snapshots with too little current change
+    uint32_t misaligned;    // No current within RINT_MAX_ALIGN_US of the Snap
+    uint32_t stale;         // Reference dropped for age
+    uint32_t resets;        // Cell count or sign changed
+};
+
+#endif // CELL_RESISTANCE_H
@@ -0,0 +1,32 @@
+#ifndef CELL_SCAN_H
+#define CELL_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Codes at or below this are empty slots, not cells (same rule as BATMan's Voltage > 10)
+#define CELL_ABSENT_MV 10
+// The SWAR kernel keeps a guard bit at the top of each 16-bit lane, so codes must stay below
+// this. Decoded cell codes are raw / 12.5 <= 5243 mV.
+#define CELL_SCAN_MAX_CODE 0x7FFF
+
+struct CellScanResult {
+    uint32_t sum;       // mV over present cells
+    uint16_t min;       // mV, 0 when no cells are present
+    uint16_t max;
+    uint16_t count;     // present cells
+    uint16_t above;     // present cells above the threshold
+};
+
+// Min/max/sum/threshold mask over a flat uint16_t array of cell codes. Absent slots are skipped.
+// mask (optional) receives bit i for every present v[i] > threshold and must hold
+// (n + 31) / 32 words.
+class CellScan {
+public:
+    // One cell per iteration, the reference
+    static void scalar(const uint16_t *v, size_t n, uint16_t threshold, CellScanResult &out, uint32_t *mask);
+    // Two cells per 32-bit word (SWAR). Same results as scalar() for codes <= CELL_SCAN_MAX_CODE.
+    static void swar(const uint16_t *v, size_t n, uint16_t threshold, CellScanResult &out, uint32_t *mask);
+};
+
+#endif // CELL_SCAN_H
@@ -0,0 +1,99 @@
+#ifndef COULOMB_COUNTER_H
+#define COULOMB_COUNTER_H
+
+#include <stdint.h>
+#include "CurrentSample.h"
+
+class HardwareSerial;
+
+// Every AS8510 sample is integrated in exact integer units, so nothing drifts however long it
+// runs: charge in mA·us (64-bit, 1 Ah = 3.6e12), energy in uW·us (96-bit, 1 Wh = 3.6e15).
+// A sample is the ADC's average over the interval since the previous one, so it is held back
+// over that interval. Gaps longer than CC_MAX_GAP_US (stalls, dropped samples) count as that long;
+// it covers the 2 s polled reads used when the sampler task is not running.
+#define CC_MAX_GAP_US          2500000
+#define CC_MAUS_PER_AH         3600000000000LL
+#define CC_UWUS_PER_WH         3.6e15
+// Checkpoints go to NVS once SOC has moved CC_CHECKPOINT_SOC_STEP, but not more often than
+// CC_CHECKPOINT_MIN_MS; any other change is saved after CC_CHECKPOINT_MAX_MS
+#define CC_CHECKPOINT_MIN_MS   60000
+#define CC_CHECKPOINT_MAX_MS   600000
+#define CC_CHECKPOINT_SOC_STEP 1.0f
+#define CC_CHECKPOINT_KEY      "coulomb"
+#define CC_CHECKPOINT_VERSION  1
+#define CC_DEFAULT_SOC         50.0f   // Until a checkpoint or "soc set" says otherwise
+
+class CoulombCounter {
+public:
+    CoulombCounter();
+
+    // Usable capacity and sign convention; call whenever the parameters may have changed
+    void configure(float capacityAh, bool invert);
+    // Restore the last checkpoint (false: none, SOC starts at CC_DEFAULT_SOC)
+    bool begin();
+    // Integrate a batch in time order; packV is the pack voltage for the energy totals
+    void addSamples(const CurrentSample *samples, uint32_t n, float packV);
+    void setSoc(float pct);
+
+    // Write SOC, AhRemain and the Ah/Wh totals to the parameters
+    void publish() const;
+    // Save a checkpoint when due
+    void loop(uint32_t nowMs);
+    bool checkpoint(uint32_t nowMs);
+
+    float soc() const;
+    float remainingAh() const { return remaining / (float)CC_MAUS_PER_AH; }
+    // Raw integer state, mA·us
+    int64_t capacityMaus() const { return capacity; }
+    int64_t remainingMaus() const { return remaining; }
+    int64_t chargeInMaus() const { return chargeIn; }
+    int64_t chargeOutMaus() const { return chargeOut; }
+    double energyInWh() const { return energyIn.wh(); }
+    double energyOutWh() const { return energyOut.wh(); }
+#ifdef ARDUINO
+    void printStatus(HardwareSerial &serialPort) const;
+#endif
+
+private:
+    // Unsigned 96-bit sum: a 64-bit accumulator with a carry word
+    struct Energy {
+        uint64_t lo;
+        uint32_t hi;
+        void add(uint64_t uWus) {
+            lo += uWus;
+            if (lo < uWus) hi++;
+        }
+        double wh() const { return (hi * 18446744073709551616.0 + lo) / CC_UWUS_PER_WH; }
+    };
+
+    struct Checkpoint {
+        uint32_t version;
+        uint32_t energyInHi;
+        int64_t remaining;
+        int64_t chargeIn;
+        int64_t chargeOut;
+        uint64_t energyInLo;
+        uint64_t energyOutLo;
+        uint32_t energyOutHi;
+        uint32_t reserved;
+    };
+
+    int64_t capacity;           // mA·us
+    bool invert;
+    int64_t remaining;          // mA·us, 0..capacity
+    int64_t chargeIn;           // mA·us, lifetime totals
+    int64_t chargeOut;
+    Energy energyIn;            // uW·us, lifetime totals
+    Energy energyOut;
+    uint32_t prevUs;
+    bool havePrev;
+    uint32_t samples;
+
+    bool restored;
+    uint32_t lastCheckpointMs;
+    float checkpointSoc;
+    int64_t checkpointThroughput;   // chargeIn + chargeOut at the last checkpoint
+    uint32_t checkpoints;
+};
+
+#endif // COULOMB_COUNTER_H
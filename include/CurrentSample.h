@@ -0,0 +1,14 @@
+#ifndef CURRENT_SAMPLE_H
+#define CURRENT_SAMPLE_H
+
+#include <stdint.h>
+
+// One AS8510 current result as queued by the sampler task; kept apart from CurrentSampler so
+// the consumers build without the framework.
+struct CurrentSample {
+    uint32_t timeUs;    // esp_timer time of the data-ready edge (low 32 bits)
+    float current;      // A
+    uint8_t gain;       // PGA gain it was measured at
+};
+
+#endif // CURRENT_SAMPLE_H
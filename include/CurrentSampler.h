@@ -0,0 +1,112 @@
+#ifndef CURRENT_SAMPLER_H
+#define CURRENT_SAMPLER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "RingBuffer.h"
+#include "CurrentSample.h"
+#include "../AS8510-library/as8510.h"
+
+// AS8510 acquisition driven by its data-ready line: the ISR only timestamps the edge and wakes
+// the sampler task, which reads the result over SPI and queues it for the main loop.
+#define CURRENT_RING_SIZE       256   // Samples; must be a power of two
+#define CURRENT_TASK_CORE       1     // Same core as loop(), which is the only other AS8510 user
+#define CURRENT_TASK_PRIORITY   4     // Above the BMB task: a late read loses a sample
+#define CURRENT_TASK_STACK      4096
+#define CURRENT_POLL_MS         20    // No edge for this long: poll data ready (INT not wired)
+#define CURRENT_HISTORY         256   // Recent samples kept for currentAt(); power of two
+
+// Auto ranging of the current channel PGA (PGA_CTL_REG D[7:6]: 00=5, 01=25, 10=40, 11=100).
+// Full scale per gain is the datasheet's input range over the shunt. Above CURRENT_RANGE_UP of
+// full scale, or on a saturation flag, the gain drops straight to one that fits; it rises a step
+// only after CURRENT_RANGE_HOLD samples below CURRENT_RANGE_DOWN of the next gain's full scale.
+#define CURRENT_PGA_REG         0x13
+#define CURRENT_STATUS2_REG     0x44  // D[7]: current channel saturated
+#define CURRENT_RANGE_UP        0.85f
+#define CURRENT_RANGE_DOWN      0.60f // Below CURRENT_RANGE_UP, so a step up never steps back
+#define CURRENT_RANGE_HOLD      16
+#define CURRENT_SETTLE_SAMPLES  2     // Results dropped after a switch: in-flight one + filter latency
+
+class CurrentSampler {
+public:
+    // baseGain is the current channel gain the sensor is constructed with, which its
+    // getCurrent() converts with; samples at any other gain are rescaled from it
+    CurrentSampler(AS8510 &sensor, uint8_t baseGain);
+
+    // Start the task and attach the data-ready interrupt. Call after the sensor's begin().
+    bool begin(uint8_t intPin);
+    bool running() const { return task != NULL; }
+
+    // Auto ranging is applied by the sampler task on its next sample; off returns to baseGain
+    void setAutoRange(bool enable) { autoRange = enable; }
+    uint8_t gain() const;
+
+    // Consumer side, main loop only
+    uint32_t drain(CurrentSample *out, uint32_t max) { return ring.drain(out, max); }
+    bool latest(CurrentSample &sample) const { return ring.latest(sample); }
+
+    // Current at timeUs, interpolated between the samples either side of it; errUs is the
+    // distance to the nearer real sample. Any task. False when timeUs is older than the history.
+    bool currentAt(uint32_t timeUs, float &amps, uint32_t &errUs) const;
+
+    // Everyone else talking to the AS8510 holds this so they don't interleave with the
+    // sampler's SPI reads. Recursive, and a no-op before begin().
+    void lockSensor();
+    void unlockSensor();
+    class SensorLock {
+    public:
+        explicit SensorLock(CurrentSampler &s) : sampler(s) { sampler.lockSensor(); }
+        ~SensorLock() { sampler.unlockSensor(); }
+    private:
+        CurrentSampler &sampler;
+    };
+
+    void printStatus(HardwareSerial &serialPort) const;
+
+private:
+    static void IRAM_ATTR dataReadyIsr(void *arg);
+    static void taskMain(void *arg);
+    void readSample(uint32_t timeUs);
+    // Both under the sensor lock
+    void rangeStep(float amps, bool saturated);
+    void setGainIndex(uint8_t index);
+    float fullScale(uint8_t index) const;
+
+    AS8510 &sensor;
+    SpscRing<CurrentSample, CURRENT_RING_SIZE> ring;
+    // Written by the sampler task under historySeq (odd while writing), readable from anywhere
+    CurrentSample history[CURRENT_HISTORY];
+    std::atomic<uint32_t> historySeq;
+    std::atomic<uint32_t> historyCount;
+    TaskHandle_t task;
+    SemaphoreHandle_t sensorMutex;
+    uint8_t intPin;
+
+    volatile uint32_t edgeUs;       // Set by the ISR, read by the task
+    uint32_t edges;                 // Data-ready interrupts seen
+    uint32_t lateEdges;             // Edges that arrived before the previous one was read
+    uint32_t polled;                // Samples taken by polling because no edge came
+    uint32_t samples;
+    uint32_t firstUs;               // For the average sample rate
+    uint32_t lastUs;
+    uint32_t maxReadUs;             // Longest edge-to-queued latency
+
+    // Gain ranging, owned by the sampler task
+    volatile bool autoRange;        // Requested by the main loop
+    uint8_t baseGain;
+    uint8_t baseIndex;
+    volatile uint8_t gainIndex;     // PGA code, 0..3
+    uint8_t settle;                 // Results still to drop after a switch
+    uint16_t quiet;                 // Consecutive samples that would fit the next gain up
+    float shuntOhm;
+    uint32_t gainChanges;
+    uint32_t saturations;
+    uint32_t settleDrops;
+    uint32_t samplesAtGain[4];
+};
+
+#endif // CURRENT_SAMPLER_H
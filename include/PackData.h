@@ -0,0 +1,76 @@
+#ifndef PACK_DATA_H
+#define PACK_DATA_H
+
+#include <stdint.h>
+
+// Pack data kernels with no hardware or framework dependency: BATMan runs them on live frames,
+// the native test environment runs them on the host.
+
+// Where a register's words land: first Voltage column, words per chip, chip block stride,
+// byte order and the integer scale raw * scaleMul / scaleDiv
+struct BmbRegLayout {
+    uint8_t reqID;
+    uint8_t firstCell;
+    uint8_t words;
+    uint8_t stride;
+    bool bigEndian;
+    uint8_t scaleMul;
+    uint8_t scaleDiv;
+};
+
+// Pack statistics from one pass over the present cells (Voltage > 10), integer mV throughout
+struct PackStats {
+    uint16_t present[8];        // Cell present bitmap per chip
+    uint16_t balance[8];        // Cells above the balance threshold, per chip (hardware register bits)
+    uint32_t sum;               // mV
+    uint16_t min;               // mV, 0 when no cells
+    uint16_t max;
+    uint16_t mean;              // mV, rounded
+    uint16_t stdDev;            // mV, population
+    uint8_t count;
+    uint8_t balancing;
+    uint8_t minCell;            // Sequential cell numbers (1-based), 0 when no cells
+    uint8_t maxCell;
+    uint8_t minChip, minReg;
+    uint8_t maxChip, maxReg;
+};
+
+// Hardware slot <-> sequential cell number for one set of present bitmaps. Cells are numbered
+// from 1 in chip order, then register order, over the slots that hold a cell.
+struct CellMap {
+    uint16_t present[8];            // Bitmaps the map was built from
+    uint8_t cellOfSlot[8][15];      // (chip, reg) -> cell number, 0 = no cell
+    uint8_t slotOfCell[8 * 15 + 1]; // cell number -> chip << 4 | reg
+    uint8_t cells;
+    uint32_t rebuilds;
+
+    void clear();
+    // Rebuild only when a cell appeared or disappeared; returns true when it did
+    bool update(const uint16_t newPresent[8]);
+};
+
+class PackData {
+public:
+    // Layout of the cell registers A-E (0x47-0x4B), indexed by ReqID - 0x47
+    static const BmbRegLayout cellRegLayout[5];
+
+    // Unpack one cell register frame for the first chips chips (at most 8) into out. Chips whose
+    // bit in pecOk is clear and words reading 0xFFFF leave the previous value in place.
+    static void decodeCellFrame(const uint8_t *frame, const BmbRegLayout &layout, uint16_t pecOk,
+                                uint8_t chips, uint16_t (*out)[15]);
+
+    // The single pass behind every cell statistic: chips chips of volts, cells above
+    // balanceAbove (mV) go into the balance bitmap (0xFFFF = none)
+    static void packStats(const uint16_t volts[8][15], uint8_t chips, uint16_t balanceAbove, PackStats &out);
+};
+
+// Cell voltages and pack current at the same instant: the Snap that froze Voltage[][] and the
+// AS8510 current interpolated to that time
+struct SyncedMeasurement {
+    uint32_t snapUs;            // esp_timer time of the Snap command
+    float current;              // A at snapUs
+    uint32_t alignErrUs;        // snapUs to the nearest real current sample
+    bool valid;                 // false: no current source, or no sample near snapUs
+};
+
+#endif // PACK_DATA_H
@@ -2,91 +2,423 @@
 #define PARAM_H
 
 #include <stdint.h>
-#include <Arduino.h>
+#include <stddef.h>
+
+// Arduino types used by the serial API; the core store builds without the framework
+class String;
+class HardwareSerial;
+
+// Parameter registry: one row per parameter. The enum, name table, storage type, unit, range,
+// default and help text are all generated from this list, so add new parameters here only.
+//   X(name, type, unit, min, max, default, deadband, group, description)
+// type is INT, FLOAT or STRING; group is one of PARAM_GROUP_LIST. Ranges apply to "param set".
+// A write only counts as a change once it moves the value by at least deadband from the last
+// change (0 = any difference), so noise below the LSB does not reach "param changes".
+#define PARAM_LIST(X) \
+    /* System parameters */ \
+    X(numbmbs,         INT,    "",         1,          4,     1,    0, SYSTEM,   "Number of BMB boards") \
+    X(LoopCnt,         INT,    "",         0, 2147483647,     0,    0, SYSTEM,   "Loop counter") \
+    X(LoopState,       INT,    "",         0,        255,     0,    0, SYSTEM,   "Current loop state") \
+    X(BalancePhase,    INT,    "",         0,          2,     0,    0, SYSTEM,   "0=measurement only, 1=even cells, 2=odd cells") \
+    X(CellsPresent,    INT,    "",         0,        120,     0,    0, SYSTEM,   "Number of cells present") \
+    X(CellsBalancing,  INT,    "",         0,        120,     0,    0, SYSTEM,   "Number of cells currently balancing") \
+    X(BalanceCellList, STRING, "",         0,          0,     0,    0, SYSTEM,   "Comma-separated list of balancing cell numbers") \
+    X(BalanceMap,      STRING, "",         0,          0,     0,    0, SYSTEM,   "Balancing cells as hex bitmap, bit 0 = cell 1") \
+    \
+    /* Cell voltage parameters (must be consecutive) */ \
+    X(u1,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u2,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u3,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u4,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u5,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u6,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u7,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u8,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u9,              INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u10,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u11,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u12,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u13,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u14,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u15,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u16,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u17,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u18,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u19,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u20,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u21,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u22,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u23,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u24,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u25,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u26,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u27,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u28,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u29,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u30,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u31,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u32,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u33,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u34,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u35,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u36,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u37,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u38,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u39,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u40,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u41,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u42,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u43,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u44,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u45,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u46,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u47,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u48,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u49,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u50,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u51,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u52,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u53,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u54,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u55,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u56,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u57,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u58,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u59,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u60,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u61,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u62,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u63,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u64,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u65,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u66,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u67,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u68,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u69,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u70,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u71,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u72,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u73,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u74,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u75,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u76,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u77,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u78,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u79,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u80,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u81,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u82,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u83,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u84,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u85,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u86,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u87,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u88,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u89,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u90,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u91,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u92,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u93,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u94,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u95,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u96,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u97,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u98,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u99,             INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u100,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u101,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u102,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u103,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u104,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u105,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u106,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u107,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    X(u108,            INT,    "mV",       0,       5000,     0,    2, CELLS,    "") \
+    \
+    /* Voltage statistics */ \
+    X(CellMax,         INT,    "",         0,        108,     0,    0, STATS,    "Cell number with maximum voltage") \
+    X(CellMin,         INT,    "",         0,        108,     0,    0, STATS,    "Cell number with minimum voltage") \
+    X(umax,            INT,    "mV",       0,       5000,     0,    2, STATS,    "Maximum cell voltage") \
+    X(umin,            INT,    "mV",       0,       5000,     0,    2, STATS,    "Minimum cell voltage") \
+    X(deltaV,          INT,    "mV",       0,       5000,     0,    2, STATS,    "Difference between max and min cells") \
+    X(udc,             FLOAT,  "V",        0,       1000,     0,  0.1, STATS,    "Total pack voltage") \
+    X(uavg,            FLOAT,  "mV",       0,       5000,     0,    2, STATS,    "Average cell voltage") \
+    X(chargeVlim,      FLOAT,  "V",        0,       1000,     0,    0, STATS,    "Charge voltage limit") \
+    X(dischargeVlim,   FLOAT,  "V",        0,       1000,     0,    0, STATS,    "Discharge voltage limit") \
+    \
+    /* Balance control */ \
+    X(balance,         INT,    "",         0,          1,     0,    0, BALANCE,  "Balance control (0=off, 1=on)") \
+    X(CellVmax,        INT,    "mV",       0,       5000,     0,    0, BALANCE,  "Maximum cell voltage for balancing") \
+    X(CellVmin,        INT,    "mV",       0,       5000,     0,    0, BALANCE,  "Minimum cell voltage for balancing") \
+    X(BalHys,          INT,    "mV",       0,        500,    20,    0, BALANCE,  "Balance cells this far above the lowest cell") \
+    \
+    /* Temperature parameters (ChiptN consecutive, CelltN_0/CelltN_1 interleaved per chip) */ \
+    X(Chipt0,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 1 die temperature") \
+    X(Chipt1,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 2 die temperature") \
+    X(Chipt2,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 3 die temperature") \
+    X(Chipt3,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 4 die temperature") \
+    X(Chipt4,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 5 die temperature") \
+    X(Chipt5,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 6 die temperature") \
+    X(Chipt6,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 7 die temperature") \
+    X(Chipt7,          FLOAT,  "",         0,      65535,     0,    0, TEMPS,    "Chip 8 die temperature") \
+    X(Cellt0_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 1 temperature sensor 1") \
+    X(Cellt0_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 1 temperature sensor 2") \
+    X(Cellt1_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 2 temperature sensor 1") \
+    X(Cellt1_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 2 temperature sensor 2") \
+    X(Cellt2_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 3 temperature sensor 1") \
+    X(Cellt2_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 3 temperature sensor 2") \
+    X(Cellt3_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 4 temperature sensor 1") \
+    X(Cellt3_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 4 temperature sensor 2") \
+    X(Cellt4_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 5 temperature sensor 1") \
+    X(Cellt4_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 5 temperature sensor 2") \
+    X(Cellt5_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 6 temperature sensor 1") \
+    X(Cellt5_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 6 temperature sensor 2") \
+    X(Cellt6_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 7 temperature sensor 1") \
+    X(Cellt6_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 7 temperature sensor 2") \
+    X(Cellt7_0,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 8 temperature sensor 1") \
+    X(Cellt7_1,        FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Chip 8 temperature sensor 2") \
+    X(TempMax,         FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Maximum temperature") \
+    X(TempMin,         FLOAT,  "C",      -40,        700,     0,  0.5, TEMPS,    "Minimum temperature") \
+    \
+    /* Chip voltages */ \
+    X(ChipV1,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 1 total voltage") \
+    X(ChipV2,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 2 total voltage") \
+    X(ChipV3,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 3 total voltage") \
+    X(ChipV4,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 4 total voltage") \
+    X(ChipV5,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 5 total voltage") \
+    X(ChipV6,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 6 total voltage") \
+    X(ChipV7,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 7 total voltage") \
+    X(ChipV8,          FLOAT,  "V",        0,        100,     0, 0.01, CHIPV,    "Chip 8 total voltage") \
+    \
+    /* Chip supplies */ \
+    X(Chip1_5V,        INT,    "mV",       0,      10000,     0,    0, SUPPLY,   "Chip 1 5V supply") \
+    X(Chip2_5V,        INT,    "mV",       0,      10000,     0,    0, SUPPLY,   "Chip 2 5V supply") \
+    \
+    /* Cell counts per chip (must be consecutive) */ \
+    X(Chip1Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 1") \
+    X(Chip2Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 2") \
+    X(Chip3Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 3") \
+    X(Chip4Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 4") \
+    X(Chip5Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 5") \
+    X(Chip6Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 6") \
+    X(Chip7Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 7") \
+    X(Chip8Cells,      INT,    "",         0,         15,     0,    0, CELLCOUNT, "Cells present on chip 8") \
+    \
+    /* AS8510 Current Sensor parameters */ \
+    X(current,         FLOAT,  "A",    -2000,       2000,     0,    0, CURRENT,  "AS8510 pack current") \
+    X(as8510_temp,     FLOAT,  "C",      -40,        150,     0,    0, CURRENT,  "AS8510 internal temperature") \
+    X(syncCurrent,     FLOAT,  "A",    -2000,       2000,     0,    0, CURRENT,  "Current at the instant the cell voltages were frozen") \
+    X(syncErrUs,       INT,    "us",       0, 2147483647,     0,    0, CURRENT,  "Time from that instant to the nearest current sample") \
+    X(CurAutoRange,    INT,    "",         0,          1,     1,    0, CURRENT,  "1=switch the current PGA gain automatically, 0=fixed") \
+    X(CurGain,         INT,    "",         5,        100,   100,    0, CURRENT,  "Current channel PGA gain in use") \
+    \
+    /* Charge accounting (coulomb counter) */ \
+    X(capacity,        FLOAT,  "Ah",       1,       2000,   220,    0, CHARGE,   "Usable pack capacity") \
+    X(CurInvert,       INT,    "",         0,          1,     0,    0, CHARGE,   "0=positive current charges the pack, 1=discharges") \
+    X(SOC,             FLOAT,  "%",        0,        100,     0,  0.1, CHARGE,   "State of charge") \
+    X(AhRemain,        FLOAT,  "Ah",       0,       2000,     0, 0.01, CHARGE,   "Charge remaining") \
+    X(AhIn,            FLOAT,  "Ah",       0, 2147483647,     0, 0.01, CHARGE,   "Total charge into the pack") \
+    X(AhOut,           FLOAT,  "Ah",       0, 2147483647,     0, 0.01, CHARGE,   "Total charge out of the pack") \
+    X(WhIn,            FLOAT,  "Wh",       0, 2147483647,     0,    1, CHARGE,   "Total energy into the pack") \
+    X(WhOut,           FLOAT,  "Wh",       0, 2147483647,     0,    1, CHARGE,   "Total energy out of the pack") \
+    \
+    /* Cell internal resistance (must be consecutive) */ \
+    X(r1,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r2,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r3,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r4,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r5,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r6,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r7,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r8,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r9,              FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r10,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r11,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r12,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r13,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r14,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r15,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r16,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r17,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r18,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r19,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r20,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r21,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r22,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r23,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r24,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r25,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r26,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r27,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r28,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r29,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r30,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r31,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r32,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r33,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r34,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r35,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r36,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r37,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r38,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r39,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r40,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r41,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r42,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r43,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r44,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r45,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r46,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r47,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r48,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r49,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r50,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r51,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r52,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r53,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r54,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r55,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r56,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r57,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r58,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r59,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r60,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r61,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r62,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r63,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r64,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r65,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r66,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r67,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r68,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r69,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r70,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r71,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r72,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r73,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r74,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r75,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r76,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r77,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r78,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r79,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r80,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r81,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r82,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r83,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r84,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r85,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r86,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r87,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r88,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r89,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r90,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r91,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r92,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r93,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r94,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r95,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r96,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r97,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r98,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r99,             FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r100,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r101,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r102,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r103,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r104,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r105,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r106,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r107,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(r108,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "") \
+    X(Rmax,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "Highest cell internal resistance") \
+    X(RmaxCell,        INT,    "",         0,        108,     0,    0, RINT,     "Cell number with the highest resistance") \
+    X(Ravg,            FLOAT,  "mOhm",     0,       1000,     0, 0.01, RINT,     "Average cell internal resistance") \
+    \
+    /* BMB scan schedule (periods and priorities consecutive, in BmbScanGroup order) */ \
+    X(ScanMode,        INT,    "",         0,          2,     0,    0, SCAN,     "BMB scan: 0=staged, 1=burst, 2=scheduled") \
+    X(ScanCellsMs,     INT,    "ms",       0,      60000,     0,    0, SCAN,     "Cells group period (0=every slot)") \
+    X(ScanChipVMs,     INT,    "ms",       0,      60000,   200,    0, SCAN,     "ChipV group period (0=every slot)") \
+    X(ScanAuxMs,       INT,    "ms",       0,      60000,  1000,    0, SCAN,     "Aux group period (0=every slot)") \
+    X(ScanCfgMs,       INT,    "ms",       0,      60000,   250,    0, SCAN,     "Cfg group period (0=every slot)") \
+    X(ScanTempMs,      INT,    "ms",       0,      60000,  2000,    0, SCAN,     "Temp group period (0=every slot)") \
+    X(ScanStatusMs,    INT,    "ms",       0,      60000,  1000,    0, SCAN,     "Status group period (0=every slot)") \
+    X(ScanCellsPri,    INT,    "",         0,        255,     7,    0, SCAN,     "Cells group priority") \
+    X(ScanChipVPri,    INT,    "",         0,        255,     3,    0, SCAN,     "ChipV group priority") \
+    X(ScanAuxPri,      INT,    "",         0,        255,     2,    0, SCAN,     "Aux group priority") \
+    X(ScanCfgPri,      INT,    "",         0,        255,     5,    0, SCAN,     "Cfg group priority") \
+    X(ScanTempPri,     INT,    "",         0,        255,     4,    0, SCAN,     "Temp group priority") \
+    X(ScanStatusPri,   INT,    "",         0,        255,     1,    0, SCAN,     "Status group priority")
+
+#define PARAM_GROUP_LIST(G) \
+    G(SYSTEM,    "System") \
+    G(CELLS,     "Cell Voltages") \
+    G(STATS,     "Voltage Stats") \
+    G(BALANCE,   "Balance") \
+    G(TEMPS,     "Temperature") \
+    G(CHIPV,     "Chip Voltages") \
+    G(SUPPLY,    "Chip Supplies") \
+    G(CELLCOUNT, "Cell Counts") \
+    G(CURRENT,   "Current Sensor") \
+    G(CHARGE,    "Charge") \
+    G(RINT,      "Cell Resistance") \
+    G(SCAN,      "Scan Schedule")
 
 class Param {
 public:
+#define PARAM_ENUM_ENTRY(name, ...) name,
     enum PARAM_NUM {
-        // System parameters
-        numbmbs,
-        LoopCnt,
-        LoopState,
-        BalancePhase,  // 0=measurement only, 1=even cells, 2=odd cells
-        CellsPresent,
-        CellsBalancing,
-        BalanceCellList,  // New: comma-separated list of balancing cell numbers
-        
-        // Cell voltage parameters (must be consecutive)
-        u1, u2, u3, u4, u5, u6, u7, u8, u9, u10,
-        u11, u12, u13, u14, u15, u16, u17, u18, u19, u20,
-        u21, u22, u23, u24, u25, u26, u27, u28, u29, u30,
-        u31, u32, u33, u34, u35, u36, u37, u38, u39, u40,
-        u41, u42, u43, u44, u45, u46, u47, u48, u49, u50,
-        u51, u52, u53, u54, u55, u56, u57, u58, u59, u60,
-        u61, u62, u63, u64, u65, u66, u67, u68, u69, u70,
-        u71, u72, u73, u74, u75, u76, u77, u78, u79, u80,
-        u81, u82, u83, u84, u85, u86, u87, u88, u89, u90,
-        u91, u92, u93, u94, u95, u96, u97, u98, u99, u100,
-        u101, u102, u103, u104, u105, u106, u107, u108,
-        
-        // Voltage statistics
-        CellMax,
-        CellMin,
-        umax,
-        umin,
-        deltaV,
-        udc,
-        uavg,
-        chargeVlim,
-        dischargeVlim,
-        
-        // Balance control
-        balance,
-        CellVmax,
-        CellVmin,
-        
-        // Temperature parameters
-        Chipt0,
-        Cellt0_0,
-        Cellt0_1,
-        TempMax,
-        TempMin,
-        
-        // Chip voltages
-        ChipV1,
-        ChipV2,
-        ChipV3,
-        ChipV4,
-        ChipV5,
-        ChipV6,
-        ChipV7,
-        ChipV8,
-        
-        // Chip supplies
-        Chip1_5V,
-        Chip2_5V,
-        
-        // Cell counts per chip
-        Chip1Cells,
-        Chip2Cells,
-        Chip3Cells,
-        Chip4Cells,
-        
-        // AS8510 Current Sensor parameters
-        current,
-        as8510_temp
+        PARAM_LIST(PARAM_ENUM_ENTRY)
+        PARAM_COUNT  // number of parameters, must stay last
+    };
+#undef PARAM_ENUM_ENTRY
+
+    enum Type : uint8_t {
+        TYPE_INT,
+        TYPE_FLOAT,
+        TYPE_STRING
+    };
+
+#define PARAM_GROUP_ENTRY(group, title) GROUP_##group,
+    enum Group : uint8_t {
+        PARAM_GROUP_LIST(PARAM_GROUP_ENTRY)
+        GROUP_COUNT
     };
+#undef PARAM_GROUP_ENTRY
+
+    struct Info {
+        const char* name;
+        Type type;
+        const char* unit;
+        int32_t min;
+        int32_t max;
+        float def;
+        float deadband;
+        Group group;
+        const char* desc;
+    };
+
+    // Registry entry for a parameter, nullptr when out of range
+    static const Info* GetInfo(PARAM_NUM param);
 
     static int GetInt(PARAM_NUM param);
     static void SetInt(PARAM_NUM param, int value);
     static float GetFloat(PARAM_NUM param);
     static void SetFloat(PARAM_NUM param, float value);
     static String GetString(PARAM_NUM param);
+    static size_t GetString(PARAM_NUM param, char* buf, size_t len);
     static void SetString(PARAM_NUM param, const String& value);
+    static void SetString(PARAM_NUM param, const char* value);
+
+    // Text produced only when the parameter is read, instead of being stored on every update.
+    // The renderer writes at most len bytes including the terminator and returns the length.
+    typedef size_t (*TextRenderer)(char* buf, size_t len);
+    static void SetRenderer(PARAM_NUM param, TextRenderer render);
     
     // Serial API methods
     static const char* GetParamName(PARAM_NUM param);
     static PARAM_NUM GetParamFromName(const char* name);
+    static PARAM_NUM GetParamFromNameNoCase(const char* name);
     static void PrintAllParams();
     static void PrintParam(PARAM_NUM param);
     static bool SetParamFromString(const char* name, const char* value);
@@ -97,6 +429,30 @@ public:
     static void PrintParam(PARAM_NUM param, HardwareSerial& serialPort);
     static bool SetParamFromString(const char* name, const char* value, HardwareSerial& serialPort);
     static void PrintParamHelp(HardwareSerial& serialPort);
+
+    // Concurrency. Writes never block: a spinlock covers only the store itself. Group the writes
+    // that belong together (a full cell scan) in BeginBatch/EndBatch; multi-parameter readers
+    // then see all of the batch or none of it. Batches may nest and may overlap between tasks;
+    // overlapping batches are published together, so give each parameter a single writer.
+    static void BeginBatch();
+    static void EndBatch();
+    // Consistent copy of several parameters as float. Waits while a write or batch is open,
+    // sleeping a tick at a time once a short spin has not seen it close, so it can block for as
+    // long as a batch stays open. Returns the store sequence number the copy belongs to.
+    static uint32_t ReadFloats(PARAM_NUM first, int count, float* out);
+    static uint32_t ReadFloats(const PARAM_NUM* params, int count, float* out);
+
+    // Change tracking. Each write that moves a value by at least its deadband takes a new change
+    // sequence number; consumers keep the last number they saw and ask for what changed since.
+    static constexpr int BITMAP_WORDS = (PARAM_COUNT + 31) / 32;
+    static uint32_t GetChangeSeq();
+    // Sets bit n of bitmap (BITMAP_WORDS words) for every parameter n changed after seq,
+    // returns the current sequence number
+    static uint32_t ChangesSince(uint32_t seq, uint32_t* bitmap);
+    static void PrintChangesSince(uint32_t seq, HardwareSerial& serialPort);
+
+    // Bytes of static storage behind all parameters
+    static size_t StorageBytes();
 };
 
 #endif // PARAM_H 
\ No newline at end of file
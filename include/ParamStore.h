@@ -0,0 +1,96 @@
+#ifndef PARAM_STORE_H
+#define PARAM_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Param.h"
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+// Configuration parameters kept across power cycles. NVS keys are the parameter names, so
+// names in this list must stay within 15 characters (checked at compile time).
+#define PARAM_PERSIST_LIST(X) \
+    X(numbmbs) \
+    X(balance) \
+    X(BalHys) \
+    X(capacity) X(CurInvert) \
+    X(CurAutoRange) \
+    X(ScanMode) \
+    X(ScanCellsMs) X(ScanChipVMs) X(ScanAuxMs) X(ScanCfgMs) X(ScanTempMs) X(ScanStatusMs) \
+    X(ScanCellsPri) X(ScanChipVPri) X(ScanAuxPri) X(ScanCfgPri) X(ScanTempPri) X(ScanStatusPri)
+
+// Changes are coalesced: a commit happens once nothing persisted has changed for the quiet
+// period, or at the latest after the max delay while values keep changing
+#define PARAM_STORE_QUIET_MS     5000
+#define PARAM_STORE_MAX_DELAY_MS 60000
+#define PARAM_STORE_NAMESPACE    "bmsparams"
+
+// Where persisted bytes go. NVS on the device; the in-memory backend stands in for it in the
+// native tests.
+class ParamBackend {
+public:
+    virtual ~ParamBackend() {}
+    // True when key exists and holds exactly len bytes
+    virtual bool load(const char* key, void* data, size_t len) = 0;
+    virtual bool save(const char* key, const void* data, size_t len) = 0;
+    virtual bool erase() = 0;
+};
+
+#ifdef ARDUINO
+class NvsParamBackend : public ParamBackend {
+public:
+    bool begin(const char* nameSpace);
+    bool load(const char* key, void* data, size_t len) override;
+    bool save(const char* key, const void* data, size_t len) override;
+    bool erase() override;
+
+private:
+    Preferences prefs;
+    bool opened = false;
+};
+#endif
+
+#define PARAM_MEM_KEYS     24
+#define PARAM_MEM_KEY_LEN  16
+#define PARAM_MEM_DATA_LEN 64    // Room for the coulomb counter checkpoint blob
+
+class MemoryParamBackend : public ParamBackend {
+public:
+    bool load(const char* key, void* data, size_t len) override;
+    bool save(const char* key, const void* data, size_t len) override;
+    bool erase() override;
+
+    uint32_t saves = 0;   // save() calls, i.e. flash writes on a real backend
+
+private:
+    struct Entry {
+        char key[PARAM_MEM_KEY_LEN];
+        uint8_t data[PARAM_MEM_DATA_LEN];
+        uint8_t len;
+    };
+    Entry entries[PARAM_MEM_KEYS] = {};
+    uint8_t used = 0;
+};
+
+class ParamStore {
+public:
+    // Load persisted parameters from backend. Call before BatStart so numbmbs is in effect.
+    static void begin(ParamBackend& backend);
+    // Watch for changes to persisted parameters and commit them after the quiet period
+    static void loop(uint32_t nowMs);
+    // Commit pending changes now. Only values that differ from what is stored get written; after
+    // a failed write the commit is retried one quiet period after the last loop() time.
+    static bool flush();
+    // Forget everything stored; parameters keep their current values until the next boot
+    static bool erase();
+
+    // Raw blobs for other modules' state (e.g. checkpoints). Keys must not be parameter names;
+    // callers are responsible for rate-limiting their writes.
+    static bool saveBlob(const char* key, const void* data, size_t len);
+    static bool loadBlob(const char* key, void* data, size_t len);
+
+    static void printStatus(HardwareSerial& serialPort);
+};
+
+#endif // PARAM_STORE_H
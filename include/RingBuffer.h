@@ -0,0 +1,74 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Fixed-size single-producer/single-consumer ring. push() belongs to one task (or ISR),
+// pop()/drain()/latest() to one other; neither side ever blocks or takes a lock.
+// Indices run freely and wrap at 2^32, so N must be a power of two.
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+public:
+    // Producer. A full ring keeps its contents and the new item is counted as dropped.
+    bool push(const T &item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) {
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buf[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: oldest item
+    bool pop(T &item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = buf[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: up to max oldest items in order, returns how many
+    uint32_t drain(T *out, uint32_t max) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t n = head.load(std::memory_order_acquire) - t;
+        if (n > max) n = max;
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] = buf[(t + i) & (N - 1)];
+        }
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer: newest item without consuming anything. The slot cannot be reused until the
+    // consumer has made room, so this is safe from the consumer side only.
+    bool latest(T &item) const {
+        uint32_t h = head.load(std::memory_order_acquire);
+        if (h == tail.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        item = buf[(h - 1) & (N - 1)];
+        return true;
+    }
+
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    uint32_t dropped() const { return drops.load(std::memory_order_relaxed); }
+    static constexpr uint32_t capacity() { return N; }
+
+private:
+    T buf[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> drops{0};
+};
+
+#endif // RING_BUFFER_H
@@ -1,9 +1,13 @@
 #include "../include/BatMan.h"
+#include "../include/BmbCrc.h"
 #include <Arduino.h>
 #include <SPI.h>
 #include <driver/spi_master.h>
 #include <driver/gpio.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <stdint.h>
+#include <string.h>
 
 /*
 This library supports SPI communication for the Tesla Model 3 BMB (battery managment boards) "Batman" chip
@@ -35,13 +39,13 @@ Damien Mcguire - EV Bmw
 */
 
 #define cycletime 5  // 5 * 100ms = 500ms = more stable balancing cycle to reduce voltage bouncing
-float BalHys = 20; //mV balance limit
+// mV balance limit: the BalHys parameter (default 20), persisted across boots
 
-uint16_t WakeUp[2] = {0x2ad4, 0x0000};
-uint16_t Mute[2] = {0x20dd, 0x0000};
-uint16_t Unmute[2] = {0x21f2, 0x0000};
-uint16_t Snap[2] = {0x2BFB, 0x0000};
-uint16_t reqTemp = 0x0E1B;//Temps returned in words 1 and 5
+uint16_t WakeUp[2] = {bmbFrames.wakeUp, 0x0000};
+uint16_t Mute[2] = {bmbFrames.mute, 0x0000};
+uint16_t Unmute[2] = {bmbFrames.unmute, 0x0000};
+uint16_t Snap[2] = {bmbFrames.snap, 0x0000};
+uint16_t reqTemp = bmbFrames.reqTemp;//Temps returned in words 1 and 5
 /* //no longer needed due to PEC calc
 uint16_t readA[2] = {0x4700, 0x7000};
 uint16_t readB[2] = {0x4800, 0x3400};
@@ -111,65 +115,11 @@ UVAR8  DCC8_1;
 UVAR8  DCC16_9;
 */
 
-uint16_t crcTable2f[256] =
-{
-    0x00, 0x2F, 0x5E, 0x71, 0xBC, 0x93, 0xE2, 0xCD, 0x57, 0x78, 0x09, 0x26, 0xEB, 0xC4, 0xB5, 0x9A,
-    0xAE, 0x81, 0xF0, 0xDF, 0x12, 0x3D, 0x4C, 0x63, 0xF9, 0xD6, 0xA7, 0x88, 0x45, 0x6A, 0x1B, 0x34,
-    0x73, 0x5C, 0x2D, 0x02, 0xCF, 0xE0, 0x91, 0xBE, 0x24, 0x0B, 0x7A, 0x55, 0x98, 0xB7, 0xC6, 0xE9,
-    0xDD, 0xF2, 0x83, 0xAC, 0x61, 0x4E, 0x3F, 0x10, 0x8A, 0xA5, 0xD4, 0xFB, 0x36, 0x19, 0x68, 0x47,
-    0xE6, 0xC9, 0xB8, 0x97, 0x5A, 0x75, 0x04, 0x2B, 0xB1, 0x9E, 0xEF, 0xC0, 0x0D, 0x22, 0x53, 0x7C,
-    0x48, 0x67, 0x16, 0x39, 0xF4, 0xDB, 0xAA, 0x85, 0x1F, 0x30, 0x41, 0x6E, 0xA3, 0x8C, 0xFD, 0xD2,
-    0x95, 0xBA, 0xCB, 0xE4, 0x29, 0x06, 0x77, 0x58, 0xC2, 0xED, 0x9C, 0xB3, 0x7E, 0x51, 0x20, 0x0F,
-    0x3B, 0x14, 0x65, 0x4A, 0x87, 0xA8, 0xD9, 0xF6, 0x6C, 0x43, 0x32, 0x1D, 0xD0, 0xFF, 0x8E, 0xA1,
-    0xE3, 0xCC, 0xBD, 0x92, 0x5F, 0x70, 0x01, 0x2E, 0xB4, 0x9B, 0xEA, 0xC5, 0x08, 0x27, 0x56, 0x79,
-    0x4D, 0x62, 0x13, 0x3C, 0xF1, 0xDE, 0xAF, 0x80, 0x1A, 0x35, 0x44, 0x6B, 0xA6, 0x89, 0xF8, 0xD7,
-    0x90, 0xBF, 0xCE, 0xE1, 0x2C, 0x03, 0x72, 0x5D, 0xC7, 0xE8, 0x99, 0xB6, 0x7B, 0x54, 0x25, 0x0A,
-    0x3E, 0x11, 0x60, 0x4F, 0x82, 0xA1, 0xD0, 0xFF, 0x3A, 0x15, 0x64, 0x4B, 0x86, 0xA5, 0xD4, 0xFB,
-    0x05, 0x2A, 0x5B, 0x74, 0xB9, 0x96, 0xE7, 0xC8, 0x42, 0x6D, 0x1C, 0x33, 0xFE, 0xD1, 0xA0, 0x8F,
-    0xAB, 0x84, 0xF5, 0xDA, 0x17, 0x38, 0x49, 0x66, 0xFC, 0xD3, 0xA2, 0x8D, 0x40, 0x6F, 0x1E, 0x31,
-    0x76, 0x59, 0x28, 0x07, 0xCA, 0xE5, 0x94, 0xBB, 0x21, 0x0E, 0x7F, 0x50, 0x9D, 0xB2, 0xC3, 0xE4
-};
-
-// CRC table for Batman data
-#define crcPolyBmData 0x025b
-
-static const uint16_t crc14table[256] =
-{
-    0x0000, 0x025b, 0x04b6, 0x06ed, 0x096c, 0x0b37, 0x0dda, 0x0f81,
-    0x12d8, 0x1083, 0x166e, 0x1435, 0x1bb4, 0x19ef, 0x1f02, 0x1d59,
-    0x25b0, 0x27eb, 0x2106, 0x235d, 0x2cdc, 0x2e87, 0x286a, 0x2a31,
-    0x3768, 0x3533, 0x33de, 0x3185, 0x3e04, 0x3c5f, 0x3ab2, 0x38e9,
-    0x093b, 0x0b60, 0x0d8d, 0x0fd6, 0x0057, 0x020c, 0x04e1, 0x06ba,
-    0x1be3, 0x19b8, 0x1f55, 0x1d0e, 0x128f, 0x10d4, 0x1639, 0x1462,
-    0x2c8b, 0x2ed0, 0x283d, 0x2a66, 0x25e7, 0x27bc, 0x2151, 0x230a,
-    0x3e53, 0x3c08, 0x3ae5, 0x38be, 0x373f, 0x3564, 0x3389, 0x31d2,
-    0x1276, 0x102d, 0x16c0, 0x149b, 0x1b1a, 0x1941, 0x1fac, 0x1df7,
-    0x00ae, 0x02f5, 0x0418, 0x0643, 0x09c2, 0x0b99, 0x0d74, 0x0f2f,
-    0x37c6, 0x359d, 0x3370, 0x312b, 0x3eaa, 0x3cf1, 0x3a1c, 0x3847,
-    0x251e, 0x2745, 0x21a8, 0x23f3, 0x2c72, 0x2e29, 0x28c4, 0x2a9f,
-    0x1b4d, 0x1916, 0x1ffb, 0x1da0, 0x1221, 0x107a, 0x1697, 0x14cc,
-    0x0995, 0x0bce, 0x0d23, 0x0f78, 0x00f9, 0x02a2, 0x044f, 0x0614,
-    0x3efd, 0x3ca6, 0x3a4b, 0x3810, 0x3791, 0x35ca, 0x3327, 0x317c,
-    0x2c25, 0x2e7e, 0x2893, 0x2ac8, 0x2549, 0x2712, 0x21ff, 0x23a4,
-    0x24ec, 0x26b7, 0x205a, 0x2201, 0x2d80, 0x2fdb, 0x2936, 0x2b6d,
-    0x3634, 0x346f, 0x3282, 0x30d9, 0x3f58, 0x3d03, 0x3bee, 0x39b5,
-    0x015c, 0x0307, 0x05ea, 0x07b1, 0x0830, 0x0a6b, 0x0c86, 0x0edd,
-    0x1384, 0x11df, 0x1732, 0x1569, 0x1ae8, 0x18b3, 0x1e5e, 0x1c05,
-    0x2dd7, 0x2f8c, 0x2961, 0x2b3a, 0x24bb, 0x26e0, 0x200d, 0x2256,
-    0x3f0f, 0x3d54, 0x3bb9, 0x39e2, 0x3663, 0x3438, 0x32d5, 0x308e,
-    0x0867, 0x0a3c, 0x0cd1, 0x0e8a, 0x010b, 0x0350, 0x05bd, 0x07e6,
-    0x1abf, 0x18e4, 0x1e09, 0x1c52, 0x13d3, 0x1188, 0x1765, 0x153e,
-    0x369a, 0x34c1, 0x322c, 0x3077, 0x3ff6, 0x3dad, 0x3b40, 0x391b,
-    0x2442, 0x2619, 0x20f4, 0x22af, 0x2d2e, 0x2f75, 0x2998, 0x2bc3,
-    0x132a, 0x1171, 0x179c, 0x15c7, 0x1a46, 0x181d, 0x1ef0, 0x1cab,
-    0x01f2, 0x03a9, 0x0544, 0x071f, 0x089e, 0x0ac5, 0x0c28, 0x0e73,
-    0x3fa1, 0x3dfa, 0x3b17, 0x394c, 0x36cd, 0x3496, 0x327b, 0x3020,
-    0x2d79, 0x2f22, 0x29cf, 0x2b94, 0x2415, 0x264e, 0x20a3, 0x22f8,
-    0x1a11, 0x184a, 0x1ea7, 0x1cfc, 0x137d, 0x1126, 0x17cb, 0x1590,
-    0x08c9, 0x0a92, 0x0c7f, 0x0e24, 0x01a5, 0x03fe, 0x0513, 0x0748
-};
-
-const uint8_t utilTopN[9] = { 0x00, 0x80, 0xc0, 0xe0, 0xf0, 0xf8, 0xfc, 0xfe, 0xff };
+// CRC-8 / CRC-14 tables and the fixed command frames are generated at compile time (BmbCrc.h)
+// Last config block sent to each chip and its PEC, so unchanged blocks skip the CRC
+static uint32_t cfgPecData[8];
+static uint16_t cfgPecCache[8];
+static bool cfgPecValid[8] = {false};
 
 // Static variable definition for register debugging
 bool BATMan::_registerDebugEnabled = false;
@@ -194,9 +144,85 @@ float Cell1start, Cell2start = 0;
 
 uint8_t BalancePhase = 0;  // 0=measurement only (no balancing), 1=even cells, 2=odd cells
 
+// Queued transactions carry a BmbQueued slot in t->user; CS is manual, so the callbacks frame it
+static void IRAM_ATTR bmb_spi_pre_cb(spi_transaction_t *t)
+{
+    BmbQueued *slot = (BmbQueued *)t->user;
+    if (slot != NULL && slot->cs) gpio_set_level(BMB_CS, 0);  // CS active low
+}
+
+static void IRAM_ATTR bmb_spi_post_cb(spi_transaction_t *t)
+{
+    BmbQueued *slot = (BmbQueued *)t->user;
+    if (slot != NULL) {
+        if (slot->cs) gpio_set_level(BMB_CS, 1);  // CS inactive high
+        slot->doneUs = (uint32_t)esp_timer_get_time();
+    }
+}
+
 // Constructor implementation
 BATMan::BATMan() {
     spi_dev = NULL;
+    dmaTx = NULL;
+    dmaRx = NULL;
+    dmaReads = false;
+    pecCheck = BMB_PEC_CHECK_DEFAULT;
+    inReread = false;
+    rereadMask = 0;
+    memset(PecErrors, 0, sizeof(PecErrors));
+    PecBlocks = 0;
+    PecRereads = 0;
+    PecRecovered = 0;
+    PecFailures = 0;
+    memset(ReadTimeUs, 0, sizeof(ReadTimeUs));
+    opCount = 0;
+    queuedCount = 0;
+    queuePending = 0;
+    queueTx = NULL;
+    queueRx = NULL;
+    queueStartUs = 0;
+    queuedMode = false;
+    spiClockHz = 1000000;  // 1 MHz
+    spiStep = 0;
+    spiCalStep = 0;
+    spiCalRequest = false;
+    spiClockRequest = 0;
+    spiWindowBlocks = 0;
+    spiWindowFailures = 0;
+    SpiBackoffs = 0;
+    stepTimer = NULL;
+    opIndex = 0;
+    stepsPending = false;
+    stepDue = false;
+    queueResume = false;
+    QueueOverflows = 0;
+    waitAccumUs = 0;
+    WaitSavedUs = 0;
+    acqTask = NULL;
+    snapSeq.store(0);
+    memset(&published, 0, sizeof(published));
+    memset(&view, 0, sizeof(view));
+    view.CellVMin = 5000;
+    cellMap.clear();
+    memset(&cellStats, 0, sizeof(cellStats));
+    cycleCount = 0;
+    reportDue = true;
+    lastReportMs = 0;
+    scanMode = BMB_SCAN_STAGED;
+    memset(scan, 0, sizeof(scan));
+    slotCount = 0;
+    scanStartMs = 0;
+    snapUs = 0;
+    cfgPhase = 0;
+    snapPhase = 0;
+    cellsFreshUs = 0;
+    publishedCellsUs = 0;
+    SnapLatencyUs = 0;
+    currentSource = NULL;
+    alignCount = 0;
+    alignMisses = 0;
+    alignSumUs = 0;
+    alignMaxUs = 0;
     ChipNum = 0;
     CellVMax = 0;
     CellVMin = 5000;
@@ -214,7 +240,6 @@ BATMan::BATMan() {
     Cell1start = 0;
     Cell2start = 0;
     BalancePhase = 0;  // Start with measurement only phase
-    LastCellBalancing = 0;  // Initialize balancing count
 }
 
 void BATMan::BatStart()
@@ -242,27 +267,46 @@ void BATMan::BatStart()
     }
     Serial.println("SPI bus initialized successfully");
     Serial.println("Configuring SPI device...");
-    spi_device_interface_config_t devcfg = {
-        .command_bits = 0,
-        .address_bits = 0,
-        .dummy_bits = 0,
-        .mode = 0,                  // SPI mode 0
-        .duty_cycle_pos = 0,
-        .cs_ena_pretrans = 0,
-        .cs_ena_posttrans = 0,
-        .clock_speed_hz = 1000000,  // 1 MHz
-        .spics_io_num = BMB_CS,
-        .flags = SPI_DEVICE_NO_DUMMY,
-        .queue_size = 1,
-        .pre_cb = NULL,
-        .post_cb = NULL
-    };
-    ret = spi_bus_add_device(BMB_SPI_HOST, &devcfg, &spi_dev);
+    ret = addSpiDevice();
     if (ret != ESP_OK) {
         Serial.printf("Failed to add SPI device! Error: %d\n", ret);
         return;
     }
     Serial.println("SPI device added successfully");
+
+    // Frame buffers for single-transaction register reads must live in DMA-capable RAM
+    dmaTx = (uint8_t *)heap_caps_malloc(BMB_FRAME_BYTES, MALLOC_CAP_DMA);
+    dmaRx = (uint8_t *)heap_caps_malloc(BMB_FRAME_BYTES, MALLOC_CAP_DMA);
+    if (dmaTx == NULL || dmaRx == NULL) {
+        Serial.println("DMA frame buffer allocation failed - using word-by-word reads");
+        heap_caps_free(dmaTx);
+        heap_caps_free(dmaRx);
+        dmaTx = NULL;
+        dmaRx = NULL;
+    } else {
+        memset(dmaTx, 0, BMB_FRAME_BYTES);
+        memset(dmaRx, 0, BMB_FRAME_BYTES);
+        dmaReads = true;
+    }
+    queueTx = (uint8_t *)heap_caps_malloc(BMB_QUEUE_ARENA, MALLOC_CAP_DMA);
+    queueRx = (uint8_t *)heap_caps_malloc(BMB_QUEUE_ARENA, MALLOC_CAP_DMA);
+    if (queueTx == NULL || queueRx == NULL) {
+        Serial.println("Queue arena allocation failed - queued mode unavailable");
+        heap_caps_free(queueTx);
+        heap_caps_free(queueRx);
+        queueTx = NULL;
+        queueRx = NULL;
+    }
+    // Inter-frame gaps are timed by a one-shot esp_timer instead of delayMicroseconds spins
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &BATMan::stepTimerCb;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "bmb_step";
+    if (esp_timer_create(&timerArgs, &stepTimer) != ESP_OK) {
+        Serial.println("BMB step timer creation failed - gaps will busy-wait");
+        stepTimer = NULL;
+    }
     Serial.println("Configuring CS pin...");
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << BMB_CS),
@@ -300,257 +344,1385 @@ void BATMan::BatStart()
 
     // Add SPI communication check here
     checkSPIConnection();
+
+#if BMB_SPI_AUTOTUNE
+    // Runs after the first full cycle, once the chips are awake
+    spiCalRequest = true;
+#endif
 }
 
-// Replace spi_xfer function with ESP32 implementation
-uint16_t BATMan::spi_xfer(spi_host_device_t host, uint16_t data)
+// Clock steps for calibration. The chain is known good at 1 MHz.
+static const uint32_t spiClockSteps[] = {1000000, 2000000, 3000000, 4000000, 5000000, 6000000, 8000000};
+#define SPI_CLOCK_STEPS (sizeof(spiClockSteps) / sizeof(spiClockSteps[0]))
+
+esp_err_t BATMan::addSpiDevice()
 {
-    spi_transaction_t t = {
-        .flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA,
-        .length = 16,
-        .tx_data = {0},
-        .rx_data = {0}
+    spi_device_interface_config_t devcfg = {
+        .command_bits = 0,
+        .address_bits = 0,
+        .dummy_bits = 0,
+        .mode = 0,                  // SPI mode 0
+        .duty_cycle_pos = 0,
+        .cs_ena_pretrans = 0,
+        .cs_ena_posttrans = 0,
+        .clock_speed_hz = (int)spiClockHz,  // 1 MHz until calibrated
+        .spics_io_num = BMB_CS,
+        .flags = SPI_DEVICE_NO_DUMMY,
+        .queue_size = BMB_QUEUE_DEPTH,
+        .pre_cb = bmb_spi_pre_cb,
+        .post_cb = bmb_spi_post_cb
     };
-    
-    // Set TX data
-    t.tx_data[0] = (data >> 8) & 0xFF;
-    t.tx_data[1] = data & 0xFF;
-    
-    // Perform SPI transaction
-    ESP_ERROR_CHECK(spi_device_transmit(spi_dev, &t));
-    
-    // Return RX data
-    return ((t.rx_data[0] << 8) | t.rx_data[1]);
+    return spi_bus_add_device(BMB_SPI_HOST, &devcfg, &spi_dev);
 }
 
-void BATMan::loop() //runs every 100ms
+// Re-add the device at a new clock. Only call with the bus idle (no queued transactions).
+bool BATMan::setSpiClock(uint32_t hz)
 {
-    StateMachine();
+    uint32_t oldHz = spiClockHz;
+
+    if (spi_dev != NULL)
+    {
+        spi_bus_remove_device(spi_dev);
+        spi_dev = NULL;
+    }
+    spiClockHz = hz;
+    if (addSpiDevice() != ESP_OK)
+    {
+        spiClockHz = oldHz;
+        if (addSpiDevice() != ESP_OK)
+        {
+            spi_dev = NULL;
+        }
+        Serial.printf("BMB SPI clock change to %lu Hz failed\n", (unsigned long)hz);
+        return false;
+    }
+    // Adding the device routes CS back to the SPI peripheral; CS is driven manually
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << BMB_CS),
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE
+    };
+    gpio_config(&io_conf);
+    gpio_set_level(BMB_CS, 1);  // CS inactive high
+    return true;
 }
 
-void BATMan::StateMachine()
+// One calibration step: the cfg register must read back the same as it did at 1 MHz. With the
+// PEC check on, every configured chip must also pass PEC on cells, aux and cfg; without it only
+// the cfg readback is trusted, since cells and aux change between reads.
+bool BATMan::spiClockStepOk(uint8_t step, const uint8_t *cfgRef)
 {
-    switch (LoopState)
+    static const uint8_t regs[] = {0x47, 0x4D, 0x50};
+    uint16_t wanted = (ChipNum >= 8) ? 0xFF : ((1 << ChipNum) - 1);
+
+    if (!setSpiClock(spiClockSteps[step]))
     {
-    case 0: //first state check if there is time out of commms requiring full wake
+        return false;
+    }
+    for (uint8_t n = 0; n < BMB_SPI_CAL_READS; n++)
     {
-        // -AI- Initial state: Check for BMB timeout and wake up if needed
-        if(BmbTimeout == true)
+        for (uint8_t r = 0; r < sizeof(regs); r++)
         {
-            WakeUP();//send wake up 4 times for 4 bmb boards
-            LoopState++;
+            if (!pecCheck && regs[r] != 0x50)
+            {
+                continue;
+            }
+            readFrame(regs[r]);
+            if (pecCheck && pecOkMask(regs[r]) != wanted)
+            {
+                return false;
+            }
+            if (regs[r] == 0x50 && memcmp(Fluffer, cfgRef, ChipNum * 7) != 0)
+            {
+                return false;
+            }
         }
-        else
+    }
+    return true;
+}
+
+// Every segment of the current command list fits the queue arena at clock hz
+bool BATMan::listFits(uint32_t hz) const
+{
+    uint8_t end;
+    uint8_t count;
+    for (uint8_t first = 0; first < opCount; first = end)
+    {
+        if (segmentBytes(first, hz, end, count) > BMB_QUEUE_ARENA || count > BMB_QUEUE_DEPTH)
         {
-            LoopState++;
+            return false;
         }
-        break;
     }
+    return true;
+}
 
-    case 1:
+// Fastest clock step at which every command list still fits the queue arena: the burst list,
+// a scheduled slot with every group due and each staged state, all with a wake-up and the
+// longer mute gap of a balancing phase. Short gaps are padded with idle bytes, which grow with
+// the clock.
+uint8_t BATMan::queueStepLimit()
+{
+    BmbOp savedOps[BMB_MAX_OPS];
+    uint8_t savedCount = opCount;
+    BmbScanItem savedScan[BMB_SCAN_GROUPS];
+    uint32_t savedSlots = slotCount;
+    bool savedBalance = BalanceFlag;
+    uint8_t savedPhase = BalancePhase;
+    bool savedTimeout = BmbTimeout;
+    memcpy(savedOps, ops, sizeof(savedOps));
+    memcpy(savedScan, scan, sizeof(savedScan));
+
+    BalanceFlag = true;
+    BalancePhase = 1;
+    BmbTimeout = true;
+    uint8_t limit = 0;
+    for (uint8_t step = 0; step < SPI_CLOCK_STEPS; step++)
     {
-        // -AI- Configuration state: Read auxiliary and configuration data
-        IdleWake();//unmute
-        GetData(0x4D);//Read Aux A.Contains 5v reg voltage in word 1
-        GetData(0x50);//Read Cfg
-        LoopState++;
-        break;
+        uint32_t hz = spiClockSteps[step];
+        bool fits = true;
+
+        buildBurstOps();
+        fits = fits && listFits(hz);
+        for (uint8_t g = 0; g < BMB_SCAN_GROUPS; g++)
+        {
+            scan[g].runs = 0;
+        }
+        buildScheduledOps();
+        fits = fits && listFits(hz);
+        for (uint16_t state = 0; state < 7; state++)
+        {
+            buildStateOps(state);
+            fits = fits && listFits(hz);
+        }
+        if (!fits)
+        {
+            break;
+        }
+        limit = step;
     }
 
-    case 2:
+    memcpy(ops, savedOps, sizeof(savedOps));
+    opCount = savedCount;
+    memcpy(scan, savedScan, sizeof(savedScan));
+    slotCount = savedSlots;
+    BalanceFlag = savedBalance;
+    BalancePhase = savedPhase;
+    BmbTimeout = savedTimeout;
+    return limit;
+}
+
+void BATMan::calibrateSpiClock()
+{
+    uint8_t cfgRef[sizeof(Fluffer)];
+    uint16_t wanted = (ChipNum >= 8) ? 0xFF : ((1 << ChipNum) - 1);
+    uint8_t best = 0;
+
+    if (ChipNum == 0 || spi_dev == NULL)
     {
-        // -AI- Snapshot state: Take snapshot of cell voltages
-        IdleWake();//unmute
-        delayMicroseconds(SendDelay);
-        Generic_Send_Once(Snap, 1);//Take a snapshot of the cell voltages
-        LoopState++;
-        break;
+        return;
+    }
+    // Reference readback at the known-good clock: it must pass PEC when that is trusted, and
+    // read the same twice in a row either way
+    setSpiClock(spiClockSteps[0]);
+    readFrame(0x50);
+    memcpy(cfgRef, Fluffer, sizeof(cfgRef));
+    readFrame(0x50);
+    if ((pecCheck && pecOkMask(0x50) != wanted) || memcmp(Fluffer, cfgRef, ChipNum * 7) != 0)
+    {
+        Serial.println("BMB SPI calibration: no clean cfg read at 1 MHz - staying at 1 MHz");
+        spiStep = 0;
+        return;
     }
 
-    case 3:
+    for (uint8_t step = 1; step < SPI_CLOCK_STEPS; step++)
     {
-        // -AI- Snapshot state: Take another snapshot of cell voltages
-        IdleWake();//unmute
-        delayMicroseconds(SendDelay);
-        Generic_Send_Once(Snap, 1);//Take a snapshot of the cell voltages
-        LoopState++;
-        break;
+        if (!spiClockStepOk(step, cfgRef))
+        {
+            break;
+        }
+        best = step;
     }
+    spiCalStep = best;
 
-    case 4:
+    // One step of margin below the fastest clean rate, and no faster than the queued lists allow
+    uint8_t limit = queueStepLimit();
+    spiStep = (best > 0) ? best - 1 : 0;
+    if (spiStep > limit)
     {
-        // -AI- Read state: Read status and cell voltage measurements
-        IdleWake();//unmute
-        delayMicroseconds(SendDelay);
-        GetData(0x4F);//Read status reg
-        delayMicroseconds(SendDelay);
-        GetData(0x4F);//Read status reg
-        delayMicroseconds(SendDelay);
-        GetData(0x47);//Read A. Contains Cell voltage measurements
-        delayMicroseconds(SendDelay);
-        GetData(0x48);//Read B. Contains Cell voltage measurements
-        delayMicroseconds(SendDelay);
-        GetData(0x49);//Read C. Contains Cell voltage measurements
-        delayMicroseconds(SendDelay);
-        GetData(0x4A);//Read D. Contains Cell voltage measurements
-        WriteCfg(); // Additional balancing command update for consistency
+        spiStep = limit;
+    }
+    setSpiClock(spiClockSteps[spiStep]);
+    spiWindowBlocks = PecBlocks;
+    spiWindowFailures = PecFailures;
+    Serial.printf("BMB SPI calibration: fastest clean %lu Hz, queue arena allows %lu Hz, running at %lu Hz\n",
+        (unsigned long)spiClockSteps[best], (unsigned long)spiClockSteps[limit], (unsigned long)spiClockHz);
+}
 
-        LoopState++;
-        break;
+// Step the clock down when the PEC failure rate over the last window is too high
+void BATMan::monitorSpiErrors()
+{
+    uint32_t blocks = PecBlocks - spiWindowBlocks;
+    uint32_t failures = PecFailures - spiWindowFailures;
+
+    if (blocks < BMB_SPI_WINDOW_BLOCKS)
+    {
+        return;
     }
+    spiWindowBlocks = PecBlocks;
+    spiWindowFailures = PecFailures;
 
-    case 5:
+    // Count-only PEC results come from an unverified reply layout; they are not an error rate
+    if (!pecCheck)
     {
-        // -AI- Read state: Read remaining cell voltages and temperature data
-        IdleWake();//unmute
-        delayMicroseconds(SendDelay);
-        GetData(0x4F);//Read status reg
-        delayMicroseconds(SendDelay);
-        GetData(0x4F);//Read status reg
-        delayMicroseconds(SendDelay);
-        GetData(0x4B);//Read E. Contains Cell voltage measurements
-        delayMicroseconds(SendDelay);
-        GetData(0x4C);//Read F. Contains chip total V in word 1.
-        delayMicroseconds(SendDelay);
-        GetData(0x4D);//Read F. Contains chip total V in word 1.
-        delayMicroseconds(SendDelay);
-        GetTempData();//Request temps
-
-        WriteCfg(); // Send balancing configuration to BMB chips
+        return;
+    }
+    if (failures * 1000 > blocks * BMB_SPI_BACKOFF_PERMILLE && spiStep > 0)
+    {
+        spiStep--;
+        SpiBackoffs++;
+        setSpiClock(spiClockSteps[spiStep]);
+        Serial.printf("BMB SPI: %lu/%lu bad blocks - clock backed off to %lu Hz\n",
+            (unsigned long)failures, (unsigned long)blocks, (unsigned long)spiClockHz);
+    }
+}
 
-        LoopState++;
-        break;
+// Called between cycles with the bus idle
+void BATMan::handleSpiRequests()
+{
+    if (spiCalRequest)
+    {
+        spiCalRequest = false;
+        calibrateSpiClock();
+    }
+    if (spiClockRequest != 0)
+    {
+        uint32_t hz = spiClockRequest;
+        spiClockRequest = 0;
+        spiStep = 0;
+        uint8_t limit = queueStepLimit();
+        for (uint8_t step = 0; step <= limit; step++)
+        {
+            if (spiClockSteps[step] <= hz) spiStep = step;
+        }
+        setSpiClock(spiClockSteps[spiStep]);
+        Serial.printf("BMB SPI clock set to %lu Hz\n", (unsigned long)spiClockHz);
     }
+    monitorSpiErrors();
+}
 
-    case 6: //first state check if there is time out of commms requiring full wake
+void BATMan::printSpiClock() const
+{
+    Serial.println("\n=== BMB SPI Clock ===");
+    Serial.printf("Running at: %lu Hz\n", (unsigned long)spiClockHz);
+    Serial.printf("Last calibration: fastest clean step %lu Hz\n", (unsigned long)spiClockSteps[spiCalStep]);
+    Serial.printf("Back-offs: %lu (window %d blocks, limit %d per mille)\n", (unsigned long)SpiBackoffs,
+        BMB_SPI_WINDOW_BLOCKS, BMB_SPI_BACKOFF_PERMILLE);
+    Serial.println("=====================\n");
+}
+
+// Move a whole frame in one DMA-backed transaction. CS is still driven by the caller.
+void BATMan::spi_frame(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+    spi_transaction_t t = {};
+    t.length = len * 8;
+    if (len <= 4)
     {
-        // -AI- Wake state: Wake up BMBs and verify configuration
-        WakeUP();//send wake up 4 times for 4 bmb boards
-        GetData(0x50);//Read Cfg
-        WriteCfg();
-        GetData(0x50);//Read Cfg
-        Generic_Send_Once(Unmute, 2);//unmute
-        LoopState++;
-        break;
+        // Short transfers go through the transaction's own data words: no DMA buffer needed
+        t.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+        memcpy(t.tx_data, tx, len);
+    }
+    else
+    {
+        t.tx_buffer = tx;
+        t.rx_buffer = rx;
     }
 
-    case 7:
+    ESP_ERROR_CHECK(spi_device_transmit(spi_dev, &t));
+    if (len <= 4)
     {
-        // -AI- Process state: Update temperature and voltage measurements
-        // Always update temperatures as they're not affected by balancing
-        upDateTemps();
-        upDateAuxVolts();
-        
-        // Only process cell voltages during Phase 0 (measurement-only phase) 
-        // to ensure stable readings without balance resistor interference
-        if(BalancePhase == 0)
+        memcpy(rx, t.rx_data, len);
+    }
+}
+
+// One 16-bit word, MSB first. CS is still driven by the caller.
+uint16_t BATMan::spi_word(uint16_t data)
+{
+    uint8_t tx[2] = {(uint8_t)(data >> 8), (uint8_t)(data & 0xFF)};
+    uint8_t rx[2];
+    spi_frame(tx, rx, 2);
+    return (rx[0] << 8) | rx[1];
+}
+
+void BATMan::loop() //runs every 100ms
+{
+    // In queued mode the bus is busy until the previous state's results are decoded
+    if (queuePending > 0 && !pollQueue())
+    {
+        return;
+    }
+    // A state still waiting on an inter-frame gap finishes before the next one starts
+    service();
+    if (stepsPending)
+    {
+        return;
+    }
+    StateMachine();
+}
+
+// Advance the current command list once its gap timer has expired. Cheap when idle, so the
+// main loop calls this on every pass rather than only on the state machine tick.
+void BATMan::service()
+{
+    if (acqTask == NULL && stepsPending && stepDue)
+    {
+        stepOps();
+    }
+}
+
+void BATMan::stepTimerCb(void *arg)
+{
+    BATMan *self = (BATMan *)arg;
+    self->stepDue = true;
+    if (self->acqTask != NULL)
+    {
+        xTaskNotifyGive(self->acqTask);
+    }
+}
+
+// Move acquisition off the Arduino loop into its own task pinned to BMB_TASK_CORE.
+// The task runs the full 8-state cycle back to back and publishes a snapshot after each one.
+bool BATMan::startTask()
+{
+    if (acqTask != NULL)
+    {
+        return true;
+    }
+    // Blocking on queued results lets the task sleep while the bus is busy
+    setQueuedMode(true);
+    if (xTaskCreatePinnedToCore(taskMain, "bmb_acq", BMB_TASK_STACK, this, BMB_TASK_PRIORITY,
+                                &acqTask, BMB_TASK_CORE) != pdPASS)
+    {
+        acqTask = NULL;
+        Serial.println("BMB acquisition task creation failed - staying on main loop");
+        return false;
+    }
+    Serial.printf("BMB acquisition task started on core %d\n", BMB_TASK_CORE);
+    return true;
+}
+
+void BATMan::taskMain(void *arg)
+{
+    BATMan *self = (BATMan *)arg;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    for (;;)
+    {
+        do
         {
-            upDateCellVolts();
-            // Add debug info to show when voltage processing occurs
-            if (_registerDebugEnabled) {
-                Serial.println("VOLTAGE PROCESSING: Phase 0 - measurement-only phase (stable readings)");
+            self->StateMachine();
+            self->waitOps();
+        } while (self->LoopState != 0);
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(BMB_TASK_MIN_PERIOD_MS));
+    }
+}
+
+// Task side: sleep until the state's command list has fully executed
+void BATMan::waitOps()
+{
+    for (;;)
+    {
+        // A long gap in queued mode alternates between the two until the list is done
+        while (queuePending > 0)
+        {
+            pollQueue(portMAX_DELAY);
+        }
+        if (!stepsPending)
+        {
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (stepDue)
+        {
+            stepOps();
+        }
+    }
+}
+
+// Writer side of the snapshot seqlock
+void BATMan::publishSnapshot()
+{
+    // Pair the cells with the current at their Snap instant before the snapshot goes out
+    SyncedMeasurement sync = {snapUs, 0, 0, false};
+    if (currentSource != NULL && snapUs != 0)
+    {
+        sync.valid = currentSource(snapUs, sync.current, sync.alignErrUs);
+        if (sync.valid)
+        {
+            alignCount++;
+            alignSumUs += sync.alignErrUs;
+            if (sync.alignErrUs > alignMaxUs)
+            {
+                alignMaxUs = sync.alignErrUs;
             }
         }
         else
         {
-            // During balancing phases, still read voltages but don't process them for balancing decisions
-            // This keeps the raw data fresh but prevents unstable readings from affecting decisions
-            // BUT we still need to update the CellsBalancing parameter for display
-            Param::SetInt(Param::CellsBalancing, LastCellBalancing);
-            
-            // CRITICAL FIX: Update individual cell voltage parameters during all phases
-            // This ensures ESPHome interface gets current voltage data even during balancing phases
-            updateIndividualCellVoltageParameters();
-            
-            if (_registerDebugEnabled) {
-                Serial.print("VOLTAGE SKIPPED: Phase ");
-                Serial.print(BalancePhase);
-                Serial.println(" - balancing active, waiting for measurement phase");
+            alignMisses++;
+        }
+    }
+
+    cycleCount++;
+    snapSeq.fetch_add(1, std::memory_order_acq_rel);  // odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    published.timestampMs = millis();
+    published.cycle = cycleCount;
+    memcpy(published.Voltage, Voltage, sizeof(published.Voltage));
+    memcpy(published.Temps, Temps, sizeof(published.Temps));
+    memcpy(published.Temp1, Temp1, sizeof(published.Temp1));
+    memcpy(published.Temp2, Temp2, sizeof(published.Temp2));
+    memcpy(published.Volts5v, Volts5v, sizeof(published.Volts5v));
+    memcpy(published.ChipV, ChipV, sizeof(published.ChipV));
+    memcpy(published.CellBalCmd, CellBalCmd, sizeof(published.CellBalCmd));
+    published.CellVMax = CellVMax;
+    published.CellVMin = CellVMin;
+    published.stats = cellStats;
+    published.sync = sync;
+    published.balancePhase = snapPhase;
+    published.cellsFresh = cellsFreshUs != publishedCellsUs;
+    publishedCellsUs = cellsFreshUs;
+    std::atomic_thread_fence(std::memory_order_release);
+    snapSeq.fetch_add(1, std::memory_order_release);  // even: consistent
+}
+
+bool BATMan::refreshView()
+{
+    static PackSnapshot copy;
+
+    for (int attempt = 0; attempt < 3; attempt++)
+    {
+        uint32_t before = snapSeq.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy(&copy, &published, sizeof(copy));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (snapSeq.load(std::memory_order_relaxed) == before)
+        {
+            if (before != 0)
+            {
+                memcpy(&view, &copy, sizeof(view));
+                cellMap.update(view.stats.present);
             }
+            return true;
+        }
+    }
+    return false;
+}
+
+void BATMan::StateMachine()
+{
+    switch (LoopState)
+    {
+    case 0: //first state check if there is time out of commms requiring full wake
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+    case 5:
+    case 6:
+    {
+        if (LoopState == 0)
+        {
+            uint8_t mode = Param::GetInt(Param::ScanMode);
+            if (mode != scanMode)
+            {
+                scanMode = mode;
+                memset(scan, 0, sizeof(scan));
+                slotCount = 0;
+                scanStartMs = millis();
+            }
+        }
+        if (scanMode != BMB_SCAN_STAGED && LoopState == 0)
+        {
+            // Burst / scheduled: states 0-6 collapsed into one tightly sequenced command list
+            if (scanMode == BMB_SCAN_SCHEDULED)
+            {
+                loadSchedule();
+                buildScheduledOps();
+            }
+            else
+            {
+                buildBurstOps();
+            }
+            executeOps();
+            LoopState = 7;
+            break;
+        }
+
+        // -AI- Bus states: build the state's command list, then execute or queue it
+        buildStateOps(LoopState);
+        executeOps();
+        LoopState++;
+        break;
+    }
+
+    case 7:
+    {
+        // Serial summaries are rate limited when the task runs cycles back to back
+        reportDue = (acqTask == NULL) || (millis() - lastReportMs >= BMB_REPORT_INTERVAL_MS);
+        if (reportDue)
+        {
+            lastReportMs = millis();
+        }
+
+        // -AI- Process state: Update temperature and voltage measurements
+        // Always update temperatures as they're not affected by balancing
+        upDateTemps();
+        upDateAuxVolts();
+        
+        // Only process cell voltages that were snapped under a phase 0 (measurement-only) config
+        // to ensure stable readings without balance resistor interference. The config in effect
+        // at the Snap is the one sent before it, usually in the previous cycle.
+        if(snapPhase == 0)
+        {
+            upDateCellVolts();
+            // Add debug info to show when voltage processing occurs
+            if (_registerDebugEnabled) {
+                Serial.println("VOLTAGE PROCESSING: Phase 0 - measurement-only phase (stable readings)");
+            }
+        }
+        else
+        {
+            // During balancing phases, still read voltages but don't process them for balancing decisions
+            // This keeps the raw data fresh but prevents unstable readings from affecting decisions.
+            // The snapshot still carries them, so the main loop keeps u1..u108 current in all phases.
+            if (_registerDebugEnabled) {
+                Serial.print("VOLTAGE SKIPPED: Phase ");
+                Serial.print(snapPhase);
+                Serial.println(" - balancing active, waiting for measurement phase");
+            }
+        }
+        
+        WaitSavedUs = waitAccumUs;
+        waitAccumUs = 0;
+        if (cellsFreshUs > snapUs)
+        {
+            SnapLatencyUs = cellsFreshUs - snapUs;
+        }
+
+        publishSnapshot();
+
+        // -AI- Toggle the balancing pattern for next cycle. Once per cycle, not per config write:
+        // staged mode writes the config three times a cycle, burst and scheduled once.
+        if(BalancePhase == 0)
+        {
+            BalancePhase = 1;
+        }
+        else if(BalancePhase == 1)
+        {
+            BalancePhase = 2;
+        }
+        else
+        {
+            BalancePhase = 0;
+        }
+
+        // Bus is idle here: apply clock calibration / changes and watch the error rate
+        handleSpiRequests();
+
+        LoopState = 0;
+        break;
+    }
+
+    case 8: //Waiting State
+    {
+        // -AI- Idle state: Wait for next cycle
+        IdleCnt++;
+
+        if(IdleCnt > cycletime)
+        {
+            LoopState = 0;
+            IdleCnt = 0;
+            LoopRanCnt++;
+            Param::SetInt(Param::LoopCnt, LoopRanCnt);
+        }
+        break;
+    }
+
+    default: //Should not get here
+    {
+        // -AI- Error state: Reset to initial state
+        break;
+    }
+
+    }
+
+    Param::SetInt(Param::LoopState, LoopState);
+    Param::SetInt(Param::BalancePhase, BalancePhase);  // Expose current balance phase
+}
+
+void BATMan::addOp(BmbOpType type, uint8_t reqID, uint16_t gapUs)
+{
+    if (opCount < BMB_MAX_OPS)
+    {
+        ops[opCount].type = type;
+        ops[opCount].reqID = reqID;
+        ops[opCount].gapUs = gapUs;
+        opCount++;
+    }
+}
+
+void BATMan::addIdleWake(uint16_t extraGapUs)
+{
+    if(BalanceFlag == true && BalancePhase != 0)
+    {
+        // Only mute during active balancing phases (1=even, 2=odd), not during measurement phase (0)
+        // mute need to do more when balancing to dig into (Primen_CMD)
+        // Add settling delay after mute command - LTC6813 datasheet specifies 100µs minimum
+        // Using 200µs to ensure stable readings with faster loop timing
+        addOp(BMB_OP_MUTE, 0, 200 + extraGapUs);
+    }
+    else
+    {
+        // During measurement phase (BalancePhase == 0) or when balancing is off, always unmute
+        // Add small delay after unmute as well for consistency
+        addOp(BMB_OP_UNMUTE, 0, 50 + extraGapUs);
+    }
+}
+
+// Command list for each bus state of StateMachine()
+void BATMan::buildStateOps(uint16_t state)
+{
+    opCount = 0;
+
+    switch (state)
+    {
+    case 0:
+        // -AI- Initial state: Check for BMB timeout and wake up if needed
+        if(BmbTimeout == true)
+        {
+            addOp(BMB_OP_WAKE);//send wake up 4 times for 4 bmb boards
+        }
+        break;
+
+    case 1:
+        // -AI- Configuration state: Read auxiliary and configuration data
+        addIdleWake(0);//unmute
+        addOp(BMB_OP_READ, 0x4D);//Read Aux A.Contains 5v reg voltage in word 1
+        addOp(BMB_OP_READ, 0x50);//Read Cfg
+        break;
+
+    case 2:
+    case 3:
+        // -AI- Snapshot state: Take snapshot of cell voltages (twice, states 2 and 3)
+        addIdleWake(SendDelay);//unmute
+        addOp(BMB_OP_SNAP);//Take a snapshot of the cell voltages
+        break;
+
+    case 4:
+        // -AI- Read state: Read status and cell voltage measurements
+        addIdleWake(SendDelay);//unmute
+        addOp(BMB_OP_READ, 0x4F, SendDelay);//Read status reg
+        addOp(BMB_OP_READ, 0x4F, SendDelay);//Read status reg
+        addOp(BMB_OP_READ, 0x47, SendDelay);//Read A. Contains Cell voltage measurements
+        addOp(BMB_OP_READ, 0x48, SendDelay);//Read B. Contains Cell voltage measurements
+        addOp(BMB_OP_READ, 0x49, SendDelay);//Read C. Contains Cell voltage measurements
+        addOp(BMB_OP_READ, 0x4A);//Read D. Contains Cell voltage measurements
+        addOp(BMB_OP_WRITECFG); // Additional balancing command update for consistency
+        break;
+
+    case 5:
+        // -AI- Read state: Read remaining cell voltages and temperature data
+        addIdleWake(SendDelay);//unmute
+        addOp(BMB_OP_READ, 0x4F, SendDelay);//Read status reg
+        addOp(BMB_OP_READ, 0x4F, SendDelay);//Read status reg
+        addOp(BMB_OP_READ, 0x4B, SendDelay);//Read E. Contains Cell voltage measurements
+        addOp(BMB_OP_READ, 0x4C, SendDelay);//Read F. Contains chip total V in word 1.
+        addOp(BMB_OP_READ, 0x4D, SendDelay);//Read F. Contains chip total V in word 1.
+        addOp(BMB_OP_TEMP);//Request temps
+        addOp(BMB_OP_WRITECFG); // Send balancing configuration to BMB chips
+        break;
+
+    case 6:
+        // -AI- Wake state: Wake up BMBs and verify configuration
+        addOp(BMB_OP_WAKE);//send wake up 4 times for 4 bmb boards
+        addOp(BMB_OP_READ, 0x50);//Read Cfg
+        addOp(BMB_OP_WRITECFG);
+        addOp(BMB_OP_READ, 0x50);//Read Cfg
+        addOp(BMB_OP_UNMUTE);//unmute
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Full pack scan for burst mode: wake -> snapshot -> read A-F -> aux -> temps -> cfg
+void BATMan::buildBurstOps()
+{
+    opCount = 0;
+
+    if(BmbTimeout == true)
+    {
+        addOp(BMB_OP_WAKE);//send wake up 4 times for 4 bmb boards
+    }
+    addIdleWake(SendDelay);//unmute
+    addOp(BMB_OP_SNAP, 0, BMB_SNAP_SETTLE_US);//Take a snapshot and let the conversion finish
+    addIdleWake(SendDelay);
+    addOp(BMB_OP_READ, 0x4F, SendDelay);//Read status reg
+    addOp(BMB_OP_READ, 0x47, SendDelay);//Read A
+    addOp(BMB_OP_READ, 0x48, SendDelay);//Read B
+    addOp(BMB_OP_READ, 0x49, SendDelay);//Read C
+    addOp(BMB_OP_READ, 0x4A, SendDelay);//Read D
+    addOp(BMB_OP_READ, 0x4B, SendDelay);//Read E
+    addOp(BMB_OP_READ, 0x4C, SendDelay);//Read F. Contains chip total V in word 1.
+    addOp(BMB_OP_READ, 0x4D, SendDelay);//Read Aux A. Contains 5v reg voltage in word 1
+    addOp(BMB_OP_TEMP);//Request temps
+    addOp(BMB_OP_READ, 0x50);//Read Cfg
+    addOp(BMB_OP_WRITECFG);//Send balancing configuration to BMB chips
+    addOp(BMB_OP_UNMUTE);//unmute
+}
+
+void BATMan::setBurstMode(bool enable)
+{
+    Param::SetInt(Param::ScanMode, enable ? BMB_SCAN_BURST : BMB_SCAN_STAGED);
+}
+
+// Scan params are indexed by BmbScanGroup
+static_assert(Param::ScanStatusMs - Param::ScanCellsMs == BMB_SCAN_STATUS &&
+              Param::ScanStatusPri - Param::ScanCellsPri == BMB_SCAN_STATUS, "Scan params out of BmbScanGroup order");
+
+// Pull periods and priorities from the param store; a period of 0 means every slot
+void BATMan::loadSchedule()
+{
+    static const uint8_t costs[BMB_SCAN_GROUPS] = {5, 1, 1, 2, 1, 1};
+
+    for (uint8_t g = 0; g < BMB_SCAN_GROUPS; g++)
+    {
+        scan[g].periodMs = (uint16_t)constrain(Param::GetInt((Param::PARAM_NUM)(Param::ScanCellsMs + g)), 0, 60000);
+        scan[g].priority = (uint8_t)constrain(Param::GetInt((Param::PARAM_NUM)(Param::ScanCellsPri + g)), 0, 255);
+        scan[g].cost = costs[g];
+    }
+}
+
+// One bus slot of the scheduled scan. Due groups are taken by priority (most overdue first on a
+// tie) until BMB_SLOT_BUDGET is used. Slow groups go between Snap and Read A so they fill the
+// cell conversion time instead of adding to it.
+void BATMan::buildScheduledOps()
+{
+    uint32_t now = millis();
+    bool picked[BMB_SCAN_GROUPS] = {false};
+    uint8_t budget = BMB_SLOT_BUDGET;
+
+    for (;;)
+    {
+        int best = -1;
+        uint32_t bestLate = 0;
+        for (uint8_t g = 0; g < BMB_SCAN_GROUPS; g++)
+        {
+            uint32_t late = now - scan[g].lastRunMs;
+            bool due = (scan[g].runs == 0) || (late >= scan[g].periodMs);
+            if (picked[g] || !due || scan[g].cost > budget)
+            {
+                continue;
+            }
+            if (best < 0 || scan[g].priority > scan[best].priority ||
+                (scan[g].priority == scan[best].priority && late > bestLate))
+            {
+                best = g;
+                bestLate = late;
+            }
+        }
+        if (best < 0)
+        {
+            break;
+        }
+        picked[best] = true;
+        budget -= scan[best].cost;
+        scan[best].lastRunMs = now;
+        scan[best].runs++;
+    }
+    slotCount++;
+
+    opCount = 0;
+    if(BmbTimeout == true)
+    {
+        addOp(BMB_OP_WAKE);//send wake up 4 times for 4 bmb boards
+    }
+    addIdleWake(SendDelay);//unmute
+
+    // Time of one register read frame plus its gap, used to shorten the snapshot settle wait
+    uint32_t frameUs = (uint32_t)BMB_FRAME_BYTES * 8000 / (spiClockHz / 1000) + SendDelay;
+    uint32_t fillUs = 0;
+    uint8_t snapOp = opCount;
+
+    if (picked[BMB_SCAN_CELLS])
+    {
+        addOp(BMB_OP_SNAP, 0, BMB_SNAP_SETTLE_US);//Take a snapshot of the cell voltages
+    }
+    if (picked[BMB_SCAN_STATUS])
+    {
+        addOp(BMB_OP_READ, 0x4F, SendDelay);//Read status reg
+        fillUs += frameUs;
+    }
+    if (picked[BMB_SCAN_AUX])
+    {
+        addOp(BMB_OP_READ, 0x4D, SendDelay);//Read Aux A. Contains 5v reg voltage in word 1
+        fillUs += frameUs;
+    }
+    if (picked[BMB_SCAN_CFG])
+    {
+        addOp(BMB_OP_READ, 0x50, SendDelay);//Read Cfg
+        fillUs += frameUs;
+    }
+    if (picked[BMB_SCAN_TEMP])
+    {
+        addOp(BMB_OP_TEMP, 0, SendDelay);//Request temps
+        fillUs += frameUs;
+    }
+    if (picked[BMB_SCAN_CELLS])
+    {
+        ops[snapOp].gapUs = (fillUs >= BMB_SNAP_SETTLE_US) ? SendDelay : BMB_SNAP_SETTLE_US - fillUs;
+        addOp(BMB_OP_READ, 0x47, SendDelay);//Read A
+        addOp(BMB_OP_READ, 0x48, SendDelay);//Read B
+        addOp(BMB_OP_READ, 0x49, SendDelay);//Read C
+        addOp(BMB_OP_READ, 0x4A, SendDelay);//Read D
+        addOp(BMB_OP_READ, 0x4B, SendDelay);//Read E
+    }
+    if (picked[BMB_SCAN_CHIPV])
+    {
+        addOp(BMB_OP_READ, 0x4C, SendDelay);//Read F. Contains chip total V in word 1.
+    }
+    if (picked[BMB_SCAN_CFG])
+    {
+        addOp(BMB_OP_WRITECFG);//Send balancing configuration to BMB chips
+    }
+    addOp(BMB_OP_UNMUTE);//unmute
+}
+
+void BATMan::printSchedule() const
+{
+    static const char *groupNames[BMB_SCAN_GROUPS] = {"cells", "chipv", "aux", "cfg", "temp", "status"};
+    static const char *modeNames[] = {"staged", "burst", "scheduled"};
+    uint32_t elapsedMs = millis() - scanStartMs;
+
+    Serial.println("\n=== BMB Scan Schedule ===");
+    Serial.printf("Mode: %s, slots: %lu, budget: %d frames/slot\n",
+        scanMode <= BMB_SCAN_SCHEDULED ? modeNames[scanMode] : "?", (unsigned long)slotCount, BMB_SLOT_BUDGET);
+    Serial.println("  Group    Period  Pri  Cost   Runs   Rate/s");
+    for (uint8_t g = 0; g < BMB_SCAN_GROUPS; g++) {
+        float rate = elapsedMs > 0 ? scan[g].runs * 1000.0f / elapsedMs : 0;
+        Serial.printf("  %-7s  %5ums  %3u  %4u  %5lu  %7.1f\n", groupNames[g], scan[g].periodMs,
+            scan[g].priority, scan[g].cost, (unsigned long)scan[g].runs, rate);
+    }
+    Serial.println("=========================\n");
+}
+
+void BATMan::executeOps()
+{
+    if (queuedMode)
+    {
+        queueOps(0);
+    }
+    else
+    {
+        startOps();
+    }
+}
+
+// Execute the current command list: send frame, arm the gap timer, yield back to the main loop
+void BATMan::startOps()
+{
+    opIndex = 0;
+    stepsPending = true;
+    stepOps();
+}
+
+// Run steps until one needs an inter-frame gap. Returns true when the list is finished.
+bool BATMan::stepOps()
+{
+    if (queueResume)
+    {
+        // End of a long gap in queued mode: the rest of the list goes back on the queue
+        queueResume = false;
+        stepsPending = false;
+        queueOps(opIndex);
+        return false;
+    }
+    while (opIndex < opCount)
+    {
+        const BmbOp &op = ops[opIndex++];
+        switch (op.type)
+        {
+        case BMB_OP_WAKE:     WakeUP(); break;
+        case BMB_OP_MUTE:     Generic_Send_Once(Mute, 2); break;
+        case BMB_OP_UNMUTE:   Generic_Send_Once(Unmute, 2); break;
+        case BMB_OP_SNAP:     Generic_Send_Once(Snap, 1); snapUs = (uint32_t)esp_timer_get_time(); snapPhase = cfgPhase; break;
+        case BMB_OP_READ:     GetData(op.reqID); break;
+        case BMB_OP_TEMP:     GetTempData(); break;
+        case BMB_OP_WRITECFG: WriteCfg(); break;
+        default: break;
+        }
+        if (op.gapUs > 0)
+        {
+            waitAccumUs += op.gapUs;
+            if (stepTimer != NULL)
+            {
+                stepDue = false;
+                esp_timer_start_once(stepTimer, op.gapUs);
+                return false;
+            }
+            delayMicroseconds(op.gapUs);
+        }
+    }
+    stepsPending = false;
+    return true;
+}
+
+// Bytes of one step's frame on the bus
+static uint16_t opFrameBytes(BmbOpType type)
+{
+    switch (type)
+    {
+    case BMB_OP_WAKE:     return 2;
+    case BMB_OP_MUTE:     return 4;
+    case BMB_OP_UNMUTE:   return 4;
+    case BMB_OP_SNAP:     return 2;
+    case BMB_OP_READ:     return BMB_FRAME_BYTES;
+    case BMB_OP_TEMP:     return 66;
+    case BMB_OP_WRITECFG: return 50;
+    default:              return 0;
+    }
+}
+
+// Idle bytes that fill gapUs at clock hz, or 0 when the gap is timed by stepTimer instead
+static uint16_t gapBytes(uint16_t gapUs, uint32_t hz)
+{
+    if (gapUs == 0 || gapUs > BMB_QUEUE_GAP_MAX_US)
+    {
+        return 0;
+    }
+    return (uint16_t)(((uint32_t)gapUs * (hz / 1000) + 7999) / 8000);
+}
+
+// Transactions and arena bytes of the queued segment starting at ops[first] at clock hz. A
+// segment ends after the first step whose gap is too long to pad (the Snap settle time); end
+// is the index after it.
+uint16_t BATMan::segmentBytes(uint8_t first, uint32_t hz, uint8_t &end, uint8_t &count) const
+{
+    uint16_t bytes = 0;
+    count = 0;
+    for (end = first; end < opCount; )
+    {
+        const BmbOp &op = ops[end++];
+        uint8_t frames = (op.type == BMB_OP_WAKE) ? 5 : 1;
+        bytes += frames * ((opFrameBytes(op.type) + 3) & ~3);
+        count += frames;
+        uint16_t idle = gapBytes(op.gapUs, hz);
+        if (idle > 0)
+        {
+            bytes += (idle + 3) & ~3;
+            count++;
+        }
+        else if (op.gapUs > BMB_QUEUE_GAP_MAX_US)
+        {
+            break;
+        }
+    }
+    return bytes;
+}
+
+// Submit the command list from ops[first] to the SPI transaction queue. Each step becomes one
+// transaction (WakeUP becomes five), and short inter-frame gaps become CS-high dummy transfers
+// so the state runs on the bus timeline while the CPU goes back to the main loop. A long gap
+// ends the segment: pollQueue() times it with stepTimer and queues the rest afterwards.
+void BATMan::queueOps(uint8_t first)
+{
+    uint8_t end;
+    uint8_t count;
+    uint16_t bytes = segmentBytes(first, spiClockHz, end, count);
+    queuedCount = 0;
+    queueResume = false;
+
+    if (bytes > BMB_QUEUE_ARENA || count > BMB_QUEUE_DEPTH)
+    {
+        // Never send part of a state: run this segment and the rest on the timed path instead
+        QueueOverflows++;
+        if (reportDue)
+        {
+            Serial.printf("BMB queue overflow (%u bytes, %u transactions) - state run unqueued\n", bytes, count);
+        }
+        opIndex = first;
+        stepsPending = true;
+        stepOps();
+        return;
+    }
+
+    uint16_t arenaPos = 0;
+    memset(queueTx, 0, bytes);
+    for (uint8_t i = first; i < end; i++)
+    {
+        const BmbOp &op = ops[i];
+        uint8_t frames = (op.type == BMB_OP_WAKE) ? 5 : 1;
+        uint16_t idle = gapBytes(op.gapUs, spiClockHz);
+
+        for (uint8_t f = 0; f <= frames; f++)
+        {
+            uint16_t words[25];
+            uint16_t len = 0;  // bytes
+            bool cs = true;
+
+            if (f == frames)
+            {
+                // Trailing gap: idle clocks with CS high
+                if (idle == 0) break;
+                len = idle;
+                cs = false;
+            }
+            else
+            {
+                switch (op.type)
+                {
+                case BMB_OP_WAKE:   words[0] = WakeUp[0]; break;
+                case BMB_OP_MUTE:   words[0] = Mute[0]; words[1] = Mute[1]; break;
+                case BMB_OP_UNMUTE: words[0] = Unmute[0]; words[1] = Unmute[1]; break;
+                // Frames are built in list order, so cfgPhase is the config the Snap runs under
+                case BMB_OP_SNAP:   words[0] = Snap[0]; snapPhase = cfgPhase; break;
+                case BMB_OP_READ:
+                {
+                    words[0] = bmbFrames.read[op.reqID - BMB_CMD_READ_FIRST][0];
+                    words[1] = bmbFrames.read[op.reqID - BMB_CMD_READ_FIRST][1];
+                    break;
+                }
+                case BMB_OP_TEMP:   words[0] = reqTemp; break;
+                case BMB_OP_WRITECFG: BuildCfgFrame(words); break;
+                default: break;
+                }
+                len = opFrameBytes(op.type);
+            }
+            if (len == 0)
+            {
+                continue;
+            }
+
+            uint16_t slotLen = (len + 3) & ~3;  // keep every DMA buffer word aligned
+            uint8_t *tx = queueTx + arenaPos;
+            if (cs)
+            {
+                uint8_t cmdWords = (op.type == BMB_OP_WRITECFG) ? 25 :
+                                   (op.type == BMB_OP_READ || op.type == BMB_OP_MUTE || op.type == BMB_OP_UNMUTE) ? 2 : 1;
+                for (uint8_t w = 0; w < cmdWords; w++)
+                {
+                    tx[w * 2] = words[w] >> 8;
+                    tx[w * 2 + 1] = words[w] & 0xFF;
+                }
+            }
+
+            BmbQueued &q = queued[queuedCount++];
+            memset(&q.t, 0, sizeof(q.t));
+            q.op = op;
+            if (!cs) q.op.type = BMB_OP_GAP;
+            q.cs = cs;
+            q.bytes = len;
+            q.doneUs = 0;
+            q.t.length = len * 8;
+            q.t.tx_buffer = tx;
+            q.t.rx_buffer = queueRx + arenaPos;
+            q.t.user = &q;
+            arenaPos += slotLen;
+        }
+        waitAccumUs += op.gapUs;
+    }
+    opIndex = end;
+
+    queueStartUs = (uint32_t)esp_timer_get_time();
+    queuePending = 0;
+    for (uint8_t i = 0; i < queuedCount; i++)
+    {
+        if (spi_device_queue_trans(spi_dev, &queued[i].t, portMAX_DELAY) != ESP_OK)
+        {
+            Serial.println("BMB queue submit failed");
+            break;
+        }
+        queuePending++;
+    }
+}
+
+// Collect finished transactions and decode them in submission order. The main loop polls
+// with wait = 0; the acquisition task blocks until the whole state is done.
+// Returns true once every transaction of the submitted state has been decoded.
+bool BATMan::pollQueue(TickType_t wait)
+{
+    spi_transaction_t *done;
+
+    while (queuePending > 0 && spi_device_get_trans_result(spi_dev, &done, wait) == ESP_OK)
+    {
+        BmbQueued *q = (BmbQueued *)done->user;
+        queuePending--;
+
+        if (q->op.type == BMB_OP_READ)
+        {
+            memcpy(Fluffer, (uint8_t *)q->t.rx_buffer + 4, sizeof(Fluffer));
+            if (q->op.reqID >= BMB_REG_FIRST && q->op.reqID < BMB_REG_FIRST + BMB_REG_COUNT)
+            {
+                uint32_t prevUs = (q == queued) ? queueStartUs : (q - 1)->doneUs;
+                ReadTimeUs[1][q->op.reqID - BMB_REG_FIRST] = q->doneUs - prevUs;
+            }
+            DecodeData(q->op.reqID);
+        }
+        else if (q->op.type == BMB_OP_TEMP)
+        {
+            DecodeTempData((const uint8_t *)q->t.rx_buffer);
+        }
+        else if (q->op.type == BMB_OP_SNAP)
+        {
+            snapUs = q->doneUs;
+        }
+    }
+    if (queuePending == 0 && opIndex < opCount)
+    {
+        // The segment ended on a long gap, counted from the end of its last frame
+        uint16_t gapUs = ops[opIndex - 1].gapUs;
+        uint32_t since = (uint32_t)esp_timer_get_time() - queued[queuedCount - 1].doneUs;
+        uint32_t remainUs = since < gapUs ? gapUs - since : 1;
+        if (stepTimer != NULL)
+        {
+            queueResume = true;
+            stepsPending = true;
+            stepDue = false;
+            esp_timer_start_once(stepTimer, remainUs);
+            return true;
+        }
+        delayMicroseconds(remainUs);
+        queueOps(opIndex);
+        return false;
+    }
+    if (queuePending == 0)
+    {
+        // Bus is free again: re-read whatever failed PEC in this state
+        rereadFailed();
+    }
+    return queuePending == 0;
+}
+
+void BATMan::printQueueTimeline() const
+{
+    static const char *opNames[] = {"WAKE", "MUTE", "UNMUTE", "SNAP", "READ", "TEMP", "WRITECFG", "GAP"};
+
+    Serial.println("\n=== BMB Queued Transaction Timeline (last segment) ===");
+    Serial.printf("Queued mode: %s, %d transactions, %d pending, %lu segments run unqueued (arena full)\n",
+        queuedMode ? "ON" : "OFF", queuedCount, queuePending, (unsigned long)QueueOverflows);
+    Serial.println("  #  Step       Reg   Bytes   Done at");
+    for (uint8_t i = 0; i < queuedCount; i++) {
+        const BmbQueued &q = queued[i];
+        Serial.printf(" %2d  %-9s  ", i, opNames[q.op.type]);
+        if (q.op.type == BMB_OP_READ) Serial.printf("0x%02X", q.op.reqID); else Serial.print("  --");
+        if (q.doneUs != 0) {
+            Serial.printf("  %5u   +%luus\n", q.bytes, (unsigned long)(q.doneUs - queueStartUs));
+        } else {
+            Serial.printf("  %5u   pending\n", q.bytes);
+        }
+    }
+    Serial.println("===================================================\n");
+}
+
+void BATMan::IdleWake()
+{
+    opCount = 0;
+    addIdleWake(0);
+    startOps();
+}
+
+void BATMan::GetData(uint8_t ReqID)
+{
+    uint32_t startUs = micros();
+
+    readFrame(ReqID);
+
+    if (ReqID >= BMB_REG_FIRST && ReqID < BMB_REG_FIRST + BMB_REG_COUNT)
+    {
+        ReadTimeUs[dmaReads ? 1 : 0][ReqID - BMB_REG_FIRST] = micros() - startUs;
+    }
+
+    DecodeData(ReqID);
+    rereadFailed();
+}
+
+// Send a register read and leave the 72 response bytes in Fluffer
+void BATMan::readFrame(uint8_t ReqID)
+{
+    // -AI- Initialize temporary arrays for command and data processing
+    uint16_t ReqData[2] = {0};
+
+    // -AI- Format command data with CRC (precomputed frame for the fixed register set)
+    if (ReqID >= BMB_CMD_READ_FIRST && ReqID < BMB_CMD_READ_FIRST + BMB_CMD_READ_COUNT)
+    {
+        ReqData[0] = bmbFrames.read[ReqID - BMB_CMD_READ_FIRST][0];
+        ReqData[1] = bmbFrames.read[ReqID - BMB_CMD_READ_FIRST][1];
+    }
+    else
+    {
+        uint8_t tempData[2] = {ReqID, BMB_CMD_READ_ADDR};
+        ReqData[0] = ReqID << 8;
+        ReqData[1] = bmbCrc8(tempData, 2) << 8;
+    }
+
+    // -AI- Activate chip select (active low)
+    gpio_set_level(BMB_CS, 0);  // CS active low
+
+    if (dmaReads)
+    {
+        // Whole command + response frame in one transaction; padding bytes after the command stay zero
+        dmaTx[0] = ReqData[0] >> 8;
+        dmaTx[1] = ReqData[0] & 0xFF;
+        dmaTx[2] = ReqData[1] >> 8;
+        dmaTx[3] = ReqData[1] & 0xFF;
+        spi_frame(dmaTx, dmaRx, BMB_FRAME_BYTES);
+        memcpy(Fluffer, dmaRx + 4, sizeof(Fluffer));
+    }
+    else
+    {
+        // -AI- Send command bytes over SPI
+        receive1 = spi_word(ReqData[0]);  // do a transfer
+        receive2 = spi_word(ReqData[1]);  // do a transfer
+
+        // -AI- Read response data (72 bytes total)
+        for (count2 = 0; count2 < 72; count2 = count2 + 2)
+        {
+            receive1 = spi_word(padding);  // do a transfer
+            Fluffer[count2] = receive1 >> 8;
+            Fluffer[count2 + 1] = receive1 & 0xFF;
+        }
+    }
+
+    // -AI- Deactivate chip select
+    gpio_set_level(BMB_CS, 1);  // CS inactive high
+}
+
+// CRC-14 check of every configured chip's block in Fluffer. Returns a bit per chip that may be
+// decoded; failures are counted and flag the register for a re-read.
+uint16_t BATMan::pecOkMask(uint8_t ReqID) const
+{
+    // 0x4C, 0x4F and 0x50 carry two words per chip (7-byte blocks), the rest three (9-byte blocks)
+    bool shortBlock = (ReqID == 0x4C || ReqID == 0x4F || ReqID == 0x50);
+    uint8_t dataLen = shortBlock ? 4 : 6;
+    uint8_t stride = bmbBlockStride(dataLen);
+    uint16_t okMask = 0;
+
+    for (uint8_t h = 0; h < ChipNum && h < 8; h++)
+    {
+        if (bmbBlockPecOk(&Fluffer[h * stride], dataLen))
+        {
+            okMask |= (1 << h);
         }
-        
-        LoopState = 0;
-        break;
     }
+    return okMask;
+}
 
-    case 8: //Waiting State
+uint16_t BATMan::checkPec(uint8_t ReqID)
+{
+    if (ReqID < BMB_REG_FIRST || ReqID >= BMB_REG_FIRST + BMB_REG_COUNT)
     {
-        // -AI- Idle state: Wait for next cycle
-        IdleCnt++;
+        return 0xFFFF;
+    }
+    uint8_t reg = ReqID - BMB_REG_FIRST;
+    uint16_t okMask = pecOkMask(ReqID);
 
-        if(IdleCnt > cycletime)
+    for (uint8_t h = 0; h < ChipNum && h < 8; h++)
+    {
+        PecBlocks++;
+        if (!(okMask & (1 << h)))
         {
-            LoopState = 0;
-            IdleCnt = 0;
-            LoopRanCnt++;
-            Param::SetInt(Param::LoopCnt, LoopRanCnt);
+            PecErrors[h][reg]++;
+            PecFailures++;
         }
-        break;
     }
 
-    default: //Should not get here
+    uint16_t wanted = (ChipNum >= 8) ? 0xFF : ((1 << ChipNum) - 1);
+    if (okMask != wanted)
     {
-        // -AI- Error state: Reset to initial state
-        break;
+        if (inReread)
+        {
+            if (_registerDebugEnabled)
+            {
+                Serial.printf("PEC: reg 0x%02X still bad after re-read (ok mask 0x%02X)\n", ReqID, okMask);
+            }
+        }
+        else
+        {
+            rereadMask |= (1 << reg);
+        }
     }
-
+    else if (inReread)
+    {
+        PecRecovered++;
     }
 
-    Param::SetInt(Param::LoopState, LoopState);
-    Param::SetInt(Param::BalancePhase, BalancePhase);  // Expose current balance phase
+    return pecCheck ? okMask : 0xFFFF;
 }
 
-
-void BATMan::IdleWake()
+// Re-read registers that failed PEC, once each. The bus must be idle (not inside a queued state).
+void BATMan::rereadFailed()
 {
-    if(BalanceFlag == true && BalancePhase != 0)
+    if (inReread || !pecCheck)
     {
-        // Only mute during active balancing phases (1=even, 2=odd), not during measurement phase (0)
-        Generic_Send_Once(Mute, 2);//mute need to do more when balancing to dig into (Primen_CMD)
-        // Add settling delay after mute command - LTC6813 datasheet specifies 100µs minimum
-        // Using 200µs to ensure stable readings with faster loop timing
-        delayMicroseconds(200);
+        rereadMask = 0;
+        return;
     }
-    else
+    inReread = true;
+    while (rereadMask)
     {
-        // During measurement phase (BalancePhase == 0) or when balancing is off, always unmute
-        Generic_Send_Once(Unmute, 2);//unmute
-        // Add small delay after unmute as well for consistency
-        delayMicroseconds(50);
+        uint8_t reg = __builtin_ctz(rereadMask);
+        rereadMask &= ~(1 << reg);
+        PecRereads++;
+        GetData(BMB_REG_FIRST + reg);
     }
+    inReread = false;
 }
 
-void BATMan::GetData(uint8_t ReqID)
+void BATMan::clearPecStats()
 {
-    // -AI- Initialize temporary arrays for command and data processing
-    uint8_t tempData[2] = {0};
-    uint16_t ReqData[2] = {0};
-
-    // -AI- Prepare command data with register ID
-    tempData[0] = ReqID;
-
-    // -AI- Format command data with CRC
-    ReqData[0] = ReqID << 8;
-    ReqData[1] = (calcCRC(tempData, 2))<<8;
-
-    // -AI- Activate chip select (active low)
-    gpio_set_level(BMB_CS, 0);  // CS active low
-
-    // -AI- Send command bytes over SPI
-    receive1 = spi_xfer(BMB_SPI_HOST, ReqData[0]);  // do a transfer
-    receive2 = spi_xfer(BMB_SPI_HOST, ReqData[1]);  // do a transfer
+    memset(PecErrors, 0, sizeof(PecErrors));
+    PecBlocks = 0;
+    PecRereads = 0;
+    PecRecovered = 0;
+    PecFailures = 0;
+    spiWindowBlocks = 0;
+    spiWindowFailures = 0;
+}
 
-    // -AI- Read response data (72 bytes total)
-    for (count2 = 0; count2 <= 72; count2 = count2 + 2)
-    {
-        receive1 = spi_xfer(BMB_SPI_HOST, padding);  // do a transfer
-        Fluffer[count2] = receive1 >> 8;
-        Fluffer[count2 + 1] = receive1 & 0xFF;
+void BATMan::printPecStats() const
+{
+    uint32_t total = 0;
+
+    Serial.println("\n=== BMB Response PEC Errors ===");
+    Serial.printf("PEC check: %s, blocks checked: %lu\n", pecCheck ? "ON (bad blocks dropped)" : "OFF (count only)",
+        (unsigned long)PecBlocks);
+    Serial.print("Chip ");
+    for (int r = 0; r < BMB_REG_COUNT; r++) {
+        Serial.printf("  0x%02X", BMB_REG_FIRST + r);
     }
+    Serial.println();
+    for (int h = 0; h < ChipNum && h < 8; h++) {
+        Serial.printf("  %d  ", h);
+        for (int r = 0; r < BMB_REG_COUNT; r++) {
+            Serial.printf("  %4u", PecErrors[h][r]);
+            total += PecErrors[h][r];
+        }
+        Serial.println();
+    }
+    Serial.printf("Total errors: %lu, re-reads: %lu, recovered: %lu\n", (unsigned long)total,
+        (unsigned long)PecRereads, (unsigned long)PecRecovered);
+    Serial.println("===============================\n");
+}
 
-    // -AI- Deactivate chip select
-    gpio_set_level(BMB_CS, 1);  // CS inactive high
-
+// Decode the response bytes in Fluffer for register ReqID
+void BATMan::DecodeData(uint8_t ReqID)
+{
     // Enhanced register debugging - show raw data when enabled
     if (_registerDebugEnabled) {
         Serial.printf("\n=== BMB Register 0x%02X Raw Data ===\n", ReqID);
@@ -566,145 +1738,50 @@ void BATMan::GetData(uint8_t ReqID)
     }
 
     uint16_t tempvol = 0;
+    uint16_t pecOk = checkPec(ReqID);  // chips whose block passed PEC; the others keep their last value
+    int chips = (ChipNum < 8) ? ChipNum : 8;
 
     switch (ReqID)
     {
     case 0x47:
-        // -AI- Read Register A: Contains cell voltage measurements for cells 1-3
-        // -AI- Each chip returns 3 words (6 bytes) of data
-        // -AI- Data format: [Word1][Word2][Word3] where each word represents one cell voltage
-        for (int h = 0; h <= 8; h++)
-        {
-            for (int g = 0; g <= 2; g++)
-            {
-                tempvol = Fluffer[1 + (h * 9) + (g * 2)] * 256 + Fluffer [0 + (h * 9) + (g * 2)];
-                if (tempvol != 0xffff)
-                {
-                    Voltage[h][g] = tempvol / 12.5;
-                }
-                
-                // Enhanced debugging for Register A (cells 1-3)
-                if (_registerDebugEnabled) {
-                    Serial.printf("  Chip %d, Reg %d: Raw=0x%04X (%5u) -> %.1fmV %s\n", 
-                        h, g, tempvol, tempvol, 
-                        (tempvol != 0xffff) ? Voltage[h][g] : 0.0f,
-                        (tempvol == 0xffff) ? "(INVALID)" : (tempvol == 0) ? "(ZERO/DEAD)" : "(VALID)");
-                }
-            }
-        }
-        if (_registerDebugEnabled) Serial.println();
-        break;
-
     case 0x48:
-        // -AI- Read Register B: Contains cell voltage measurements for cells 4-6
-        // -AI- Each chip returns 3 words (6 bytes) of data
-        // -AI- Data format: [Word1][Word2][Word3] where each word represents one cell voltage
-        for (int h = 0; h <= 8; h++)
-        {
-            for (int g = 3; g <= 5; g++)
-            {
-                tempvol = Fluffer[1 + (h * 9) + ((g - 3) * 2)] * 256 + Fluffer [0 + (h * 9) + ((g - 3) * 2)];
-                if (tempvol != 0xffff)
-                {
-                    Voltage[h][g] = tempvol / 12.5;
-                }
-                
-                // Enhanced debugging for Register B (cells 4-6)
-                if (_registerDebugEnabled) {
-                    Serial.printf("  Chip %d, Reg %d: Raw=0x%04X (%5u) -> %.1fmV %s\n", 
-                        h, g, tempvol, tempvol, 
-                        (tempvol != 0xffff) ? Voltage[h][g] : 0.0f,
-                        (tempvol == 0xffff) ? "(INVALID)" : (tempvol == 0) ? "(ZERO/DEAD)" : "(VALID)");
-                }
-            }
-        }
-        if (_registerDebugEnabled) Serial.println();
-        break;
-
     case 0x49:
-        // -AI- Read Register C: Contains cell voltage measurements for cells 7-9
-        // -AI- Each chip returns 3 words (6 bytes) of data
-        // -AI- Data format: [Word1][Word2][Word3] where each word represents one cell voltage
-        for (int h = 0; h <= 8; h++)
-        {
-            for (int g = 6; g <= 8; g++)
-            {
-                tempvol = Fluffer[1 + (h * 9) + ((g - 6) * 2)] * 256 + Fluffer [0 + (h * 9) + ((g - 6) * 2)];
-                if (tempvol != 0xffff)
-                {
-                    Voltage[h][g] = tempvol / 12.5 ;
-                }
-                
-                // Enhanced debugging for Register C (cells 7-9)
-                if (_registerDebugEnabled) {
-                    Serial.printf("  Chip %d, Reg %d: Raw=0x%04X (%5u) -> %.1fmV %s\n", 
-                        h, g, tempvol, tempvol, 
-                        (tempvol != 0xffff) ? Voltage[h][g] : 0.0f,
-                        (tempvol == 0xffff) ? "(INVALID)" : (tempvol == 0) ? "(ZERO/DEAD)" : "(VALID)");
-                }
-            }
-        }
-        if (_registerDebugEnabled) Serial.println();
-        break;
-
     case 0x4A:
-        // -AI- Read Register D: Contains cell voltage measurements for cells 10-12
-        // -AI- Each chip returns 3 words (6 bytes) of data
-        // -AI- Data format: [Word1][Word2][Word3] where each word represents one cell voltage
-        for (int h = 0; h <= 8; h++)
+    case 0x4B:
+        if (ReqID == 0x4B)
         {
-            for (int g = 9; g <= 11; g++)
-            {
-                tempvol = Fluffer[1 + (h * 9) + ((g - 9) * 2)] * 256 + Fluffer [0 + (h * 9) + ((g - 9) * 2)];
-                if (tempvol != 0xffff)
-                {
-                    Voltage[h][g] = tempvol / 12.5;
-                }
-                
-                // Enhanced debugging for Register D (cells 10-12)
-                if (_registerDebugEnabled) {
-                    Serial.printf("  Chip %d, Reg %d: Raw=0x%04X (%5u) -> %.1fmV %s\n", 
-                        h, g, tempvol, tempvol, 
-                        (tempvol != 0xffff) ? Voltage[h][g] : 0.0f,
-                        (tempvol == 0xffff) ? "(INVALID)" : (tempvol == 0) ? "(ZERO/DEAD)" : "(VALID)");
-                }
-            }
+            cellsFreshUs = (uint32_t)esp_timer_get_time();  // last cell register of the snapshot
         }
-        if (_registerDebugEnabled) Serial.println();
-        break;
+        // -AI- Cell registers A-E: each chip returns 3 words (6 bytes) of data, one cell voltage per word
+        PackData::decodeCellFrame(Fluffer, PackData::cellRegLayout[ReqID - 0x47], pecOk, ChipNum, Voltage);
 
-    case 0x4B:
-        // -AI- Read Register E: Contains cell voltage measurements for cells 13-15
-        // -AI- Each chip returns 3 words (6 bytes) of data
-        // -AI- Data format: [Word1][Word2][Word3] where each word represents one cell voltage
-        for (int h = 0; h <= 8; h++)
+        // Enhanced debugging for cell registers
+        if (_registerDebugEnabled)
         {
-            for (int g = 12; g <= 14; g++)
+            const BmbRegLayout &layout = PackData::cellRegLayout[ReqID - 0x47];
+            for (int h = 0; h < chips; h++)
             {
-                tempvol = Fluffer[1 + (h * 9) + ((g - 12) * 2)] * 256 + Fluffer [0 + (h * 9) + ((g - 12) * 2)];
-                if (tempvol != 0xffff)
+                if (!(pecOk & (1 << h))) continue;
+                for (int g = 0; g < layout.words; g++)
                 {
-                    Voltage[h][g] = tempvol / 12.5;
-                }
-                
-                // Enhanced debugging for Register E (cells 13-15)
-                if (_registerDebugEnabled) {
-                    Serial.printf("  Chip %d, Reg %d: Raw=0x%04X (%5u) -> %.1fmV %s\n", 
-                        h, g, tempvol, tempvol, 
-                        (tempvol != 0xffff) ? Voltage[h][g] : 0.0f,
-                        (tempvol == 0xffff) ? "(INVALID)" : (tempvol == 0) ? "(ZERO/DEAD)" : "(VALID)");
+                    uint16_t raw = Fluffer[h * layout.stride + 2 * g + 1] * 256 + Fluffer[h * layout.stride + 2 * g];
+                    Serial.printf("  Chip %d, Reg %d: Raw=0x%04X (%5u) -> %umV %s\n",
+                        h, layout.firstCell + g, raw, raw,
+                        (raw != 0xffff) ? Voltage[h][layout.firstCell + g] : 0,
+                        (raw == 0xffff) ? "(INVALID)" : (raw == 0) ? "(ZERO/DEAD)" : "(VALID)");
                 }
             }
+            Serial.println();
         }
-        if (_registerDebugEnabled) Serial.println();
         break;
 
     case 0x4C:
         // -AI- Read Register F: Contains chip total voltage in word 1
         // -AI- Each chip returns 7 bytes of data
         // -AI- Data format: [Word1] where Word1 represents total chip voltage
-        for (int h = 0; h <= 8; h++)
+        for (int h = 0; h < chips; h++)
         {
+            if (!(pecOk & (1 << h))) continue;
             tempvol = Fluffer[3 + (h * 7)] * 256 + Fluffer [2 + (h * 7)];
             if (tempvol != 0xffff)
             {
@@ -720,8 +1797,9 @@ void BATMan::GetData(uint8_t ReqID)
         // -AI-   Temp1: Internal Temperature 1
         // -AI-   5V: 5V Supply Voltage (needs byte order reversal for chips 0,3,5,7)
         // -AI-   Temp2: Internal Temperature 2
-        for (int h = 0; h < 8; h++)
+        for (int h = 0; h < chips; h++)
         {
+            if (!(pecOk & (1 << h))) continue;
             // Read first word - Internal Temperature 1
             // Each chip returns 9 bytes of data (3 words) in this format:
             // Word 1: Internal Temperature 1
@@ -765,8 +1843,9 @@ void BATMan::GetData(uint8_t ReqID)
         // -AI- Data format: [Word1][Word2] where:
         // -AI-   Word1: Configuration register 1
         // -AI-   Word2: Configuration register 2
-        for (int h = 0; h < 8; h++)
+        for (int h = 0; h < chips; h++)
         {
+            if (!(pecOk & (1 << h))) continue;
             tempvol = Fluffer[0 + (h * 7)] * 256 + Fluffer [1 + (h * 7)];
             if (tempvol != 0xffff)
             {
@@ -789,16 +1868,32 @@ void BATMan::GetData(uint8_t ReqID)
 
 
 void BATMan::WriteCfg()
+{
+    uint16_t cfgwrt [25] = {0};
+
+    BuildCfgFrame(cfgwrt);
+
+    // -AI- Send the configuration data over SPI
+    gpio_set_level(BMB_CS, 0);  // CS active low
+
+    for (int cnt = 0; cnt < 25; cnt++)
+    {
+        receive1 = spi_word(cfgwrt[cnt]);  // do a transfer
+    }
+    gpio_set_level(BMB_CS, 1);  // CS inactive high
+}
+
+// Fill the 25-word write config frame from CellBalCmd for the current balance phase
+void BATMan::BuildCfgFrame(uint16_t cfgwrt[25])
 {
     // CMD(one byte) PEC(one byte)
     uint8_t tempData[6] = {0};
 
     //uint8_t DCC16_9 = 0;
     //uint8_t DCC8_1 = 0;
-    uint16_t cfgwrt [25] = {0};
 
     // -AI- Set the write configuration command (0x11) with PEC
-    cfgwrt[0]= 0x112F;        //CMD
+    cfgwrt[0]= bmbFrames.writeCfg;        //CMD
 
     for (int h = 0; h < 8; h++)//write the 8 BMB registers
     {
@@ -832,10 +1927,16 @@ void BATMan::WriteCfg()
         }
 
         // -AI- Calculate PEC (Packet Error Code) for data integrity
-        uint16_t payPec =0x0010;
-
-        crc14_bytes(4,tempData,&payPec);
-        crc14_bits(2,2,&payPec);
+        // Balancing only changes a chip's block now and then, so reuse the last PEC when it matches
+        uint32_t block = ((uint32_t)tempData[0] << 24) | ((uint32_t)tempData[1] << 16) |
+                         ((uint32_t)tempData[2] << 8) | tempData[3];
+        if (!cfgPecValid[h] || cfgPecData[h] != block)
+        {
+            cfgPecData[h] = block;
+            cfgPecCache[h] = bmbCfgPec(tempData[0], tempData[1], tempData[2], tempData[3]);
+            cfgPecValid[h] = true;
+        }
+        uint16_t payPec = cfgPecCache[h];
 
         // -AI- Pack the configuration data into the write buffer
         cfgwrt[1+h*3] = tempData[1] + (tempData[0] << 8);
@@ -843,39 +1944,40 @@ void BATMan::WriteCfg()
         cfgwrt[3+h*3] = payPec;//Contains the PEC and other shit
 
     }
-    // -AI- Toggle the balancing pattern for next cycle
-    if(BalancePhase == 0)
-    {
-        BalancePhase = 1;
-    }
-    else if(BalancePhase == 1)
-    {
-        BalancePhase = 2;
-    }
-    else
-    {
-        BalancePhase = 0;
-    }
+    cfgPhase = BalancePhase;
+}
 
-    // -AI- Send the configuration data over SPI
-    gpio_set_level(BMB_CS, 0);  // CS active low
 
-    for (int cnt = 0; cnt < 25; cnt++)
+void BATMan::GetTempData ()  //request
+{
+    uint8_t rx[66];
+
+    padding=0x0000;
+    gpio_set_level(BMB_CS, 0);  // CS active low
+    receive1 = spi_word(reqTemp);  // do a transfer
+    rx[0] = receive1 >> 8;
+    rx[1] = receive1 & 0xFF;
+    for (count3 = 0; count3 < 32; count3 ++)
     {
-        receive1 = spi_xfer(BMB_SPI_HOST, cfgwrt[cnt]);  // do a transfer
+        receive1 = spi_word(padding);  // do a transfer
+        rx[2 + count3 * 2] = receive1 >> 8;
+        rx[3 + count3 * 2] = receive1 & 0xFF;
     }
     gpio_set_level(BMB_CS, 1);  // CS inactive high
-}
 
+    DecodeTempData(rx);
 
-void BATMan::GetTempData ()  //request
+    //Param::SetFloat(Param::temp,69);
+
+    //delay(200);
+}
+
+// Decode a temperature response frame: request word followed by 32 response words
+void BATMan::DecodeTempData(const uint8_t *rx)
 {
-    padding=0x0000;
-    gpio_set_level(BMB_CS, 0);  // CS active low
-    receive1 = spi_xfer(BMB_SPI_HOST, reqTemp);  // do a transfer
     for (count3 = 0; count3 < 32; count3 ++)
     {
-        receive1 = spi_xfer(BMB_SPI_HOST, padding);  // do a transfer
+        receive1 = (rx[2 + count3 * 2] << 8) | rx[3 + count3 * 2];
         if(receive1 != 0xFFFF)
         {
             if(count3==1) Temps[0]=receive1;//temperature 1
@@ -888,11 +1990,6 @@ void BATMan::GetTempData ()  //request
             if(count3==29) Temps[7]=receive1;//temperature 8
         }
     }
-    gpio_set_level(BMB_CS, 1);  // CS inactive high
-
-    //Param::SetFloat(Param::temp,69);
-
-    //delay(200);
 }
 
 void BATMan::WakeUP()
@@ -900,7 +1997,7 @@ void BATMan::WakeUP()
     for (count1 = 0; count1 <= 4; count1++)
     {
         gpio_set_level(BMB_CS, 0);  // CS active low
-        receive1 = spi_xfer(BMB_SPI_HOST, WakeUp[0]);  // do a transfer
+        receive1 = spi_word(WakeUp[0]);  // do a transfer
         gpio_set_level(BMB_CS, 1);  // CS inactive high
     }
 }
@@ -910,143 +2007,62 @@ void BATMan::Generic_Send_Once(uint16_t Command[], uint8_t len)
     gpio_set_level(BMB_CS, 0);  // CS active low
     for (int h = 0; h < len; h++)
     {
-        receive1 = spi_xfer(BMB_SPI_HOST, Command[h]);  // do a transfer
+        receive1 = spi_word(Command[h]);  // do a transfer
     }
     gpio_set_level(BMB_CS, 1);  // CS inactive high
 }
 
+// Balance cells above the previous scan's minimum (umin) plus BalHys (mV); 0xFFFF with balancing off
+uint16_t BATMan::balanceThreshold() const
+{
+    if (!Param::GetInt(Param::balance))
+    {
+        return 0xFFFF;
+    }
+    float threshold = CellVMin + Param::GetInt(Param::BalHys);
+    return threshold < 0xFFFF ? (uint16_t)threshold : 0xFFFF;
+}
+
 void BATMan::upDateCellVolts(void)
 {
-    // -AI- Initialize tracking variables for cell monitoring
-    uint8_t Xr = 0; //BMB number
-    uint8_t Yc = 0; //Cell voltage register number
-    uint8_t hc = 0; //Cells present per chip
-    uint8_t h = 0; //Spot value index
-    uint16_t CellBalancing = 0;
+    // -AI- Cell balancing logic:
+    // 1. Check if balancing is enabled
+    // 2. If cell voltage is above minimum + hysteresis, enable balancing
+    // 3. Set corresponding bit in CellBalCmd register using HARDWARE POSITION
+    uint16_t balanceAbove = balanceThreshold();
+
+    // One pass over the raw readings: min/max with positions, sum, spread and balance bits
+    PackData::packStats(Voltage, ChipNum, balanceAbove, cellStats);
+    uint16_t CellBalancing = cellStats.balancing;
 
     // -AI- Reset balancing state and voltage tracking
-    BalanceFlag = false;
-    CellVMax = 0;
-    CellVMin = 5000;
+    CellVMax = cellStats.count ? cellStats.max : 0;
+    CellVMin = cellStats.count ? cellStats.min : 5000;
+    BalanceFlag = CellBalancing > 0;
 
-    // -AI- Clear all cell balancing commands
+    // -AI- CRITICAL FIX: Set bit in balancing command register using HARDWARE REGISTER POSITION (Yc)
+    // NOT sequential cell number (h). This ensures balancing commands map to correct hardware registers.
     for(uint8_t L =0; L < 8; L++)
     {
-        CellBalCmd[L] = 0;
+        CellBalCmd[L] = cellStats.balance[L];
     }
 
-    // -AI- Process all cells across all BMB chips
-    while (h <= 108)
-    {
-        if(Yc < 15) //Check actual measurement present (include register 14)
-        {
-            if(Voltage[Xr][Yc] > 10) //Check actual measurement present
-            {
-                // -AI- Track maximum cell voltage and its position
-                if (CellVMax< Voltage[Xr][Yc])
-                {
-                    CellVMax =  Voltage[Xr][Yc];
-                    // Store both sequential cell number and hardware position
-                    Param::SetInt(Param::CellMax, h+1);
-                }
-                // -AI- Track minimum cell voltage and its position
-                if (CellVMin > Voltage[Xr][Yc])
-                {
-                    CellVMin =  Voltage[Xr][Yc];
-                    // Store both sequential cell number and hardware position
-                    Param::SetInt(Param::CellMin, h+1);
-                }
-                // -AI- Store cell voltage in parameter system
-                Param::SetFloat((Param::PARAM_NUM)(Param::u1 + h), (Voltage[Xr][Yc]));
-
-                // -AI- Cell balancing logic:
-                // 1. Check if balancing is enabled
-                // 2. If cell voltage is above minimum + hysteresis, enable balancing
-                // 3. Set corresponding bit in CellBalCmd register using HARDWARE POSITION
-                if(Param::GetInt(Param::balance)) // Check if balancing flag is set
-                {
-                    if((Param::GetFloat(Param::umin) + BalHys) < Voltage[Xr][Yc])
-                    {
-                        // -AI- CRITICAL FIX: Set bit in balancing command register using HARDWARE REGISTER POSITION (Yc)
-                        // NOT sequential cell number (h). This ensures balancing commands map to correct hardware registers.
-                        CellBalCmd[Xr] = CellBalCmd[Xr] | (0x01 << Yc);
-                        CellBalancing++;
-                        BalanceFlag = true;
-                    }
-                }
-                //
-                h++; //next cell spot value along
-                hc++; //one more cell present
-            }
-
-            Yc++; //next cell along
-        }
-        else
-        {
-            // -AI- Store number of cells present for this BMB chip
-            Param::SetInt((Param::PARAM_NUM)(Param::Chip1Cells+Xr),hc);
-            Yc = 0; //reset Cell colum
-            hc = 0; //reset cell count per chip
-            Xr++; //next BMB
-        }
-
-        if(Xr == ChipNum)
-        {
-            // -AI- Store overall pack statistics
-            Param::SetFloat(Param::umax,CellVMax);
-            Param::SetFloat(Param::umin,CellVMin);
-            Param::SetFloat(Param::deltaV,CellVMax-CellVMin);
-            Param::SetInt(Param::CellsPresent,h);
-            h = 108;
-            break;
-        }
-    }
+    // Cell voltages, statistics and balance counts reach the param store through the published
+    // snapshot: the main loop is their only writer (updateParametersFromBATMan)
 
-    // -AI- Store number of cells currently being balanced - ALWAYS update this parameter
-    // During Phase 0 (measurement-only), calculate and preserve the balancing count
-    // During other phases, use the preserved count so display shows correct balancing status
-    if(BalancePhase == 0) {
-        // Phase 0: Store the calculated balancing count for use in other phases
-        LastCellBalancing = CellBalancing;
-        Param::SetInt(Param::CellsBalancing, CellBalancing);
-    } else {
-        // Phase 1 & 2: Use the preserved balancing count from Phase 0
-        Param::SetInt(Param::CellsBalancing, LastCellBalancing);
-    }
-
-    // -AI- Debug tracking of initial cell voltages
-    if(Cell1start == 0)
-    {
-        Cell1start= Param::GetFloat(Param::u1);
-        Cell2start=Param::GetFloat(Param::u2);
-    }
+    if (!reportDue) return;
 
     // Print cell voltage information with hardware position mapping
     Serial.println("\n=== Cell Voltage Information ===");
-    Serial.printf("Total Cells Present: %d\n", Param::GetInt(Param::CellsPresent));
-    Serial.printf("Max Cell Voltage: %.3fV (Cell %d)\n", CellVMax/1000.0, Param::GetInt(Param::CellMax));
-    Serial.printf("Min Cell Voltage: %.3fV (Cell %d)\n", CellVMin/1000.0, Param::GetInt(Param::CellMin));
+    Serial.printf("Total Cells Present: %d\n", cellStats.count);
+    Serial.printf("Max Cell Voltage: %.3fV (Cell %d)\n", CellVMax/1000.0, cellStats.maxCell);
+    Serial.printf("Min Cell Voltage: %.3fV (Cell %d)\n", CellVMin/1000.0, cellStats.minCell);
     Serial.printf("Voltage Delta: %.3fV\n", (CellVMax-CellVMin)/1000.0);
+    Serial.printf("Mean / Std Dev: %.3fV / %u mV\n", cellStats.mean/1000.0, cellStats.stdDev);
     Serial.printf("Cells Balancing: %d\n", CellBalancing);
     
-    // Calculate sum of all cell voltages by dynamically counting all present cells
-    float totalCellVoltage = 0;
-    int actualCellCount = 0;
-    for (int chip = 0; chip < ChipNum; chip++) {
-        for (int reg = 0; reg < 15; reg++) {
-            if (Voltage[chip][reg] > 10) { // Cell is present
-                totalCellVoltage += Voltage[chip][reg];
-                actualCellCount++;
-            }
-        }
-    }
-    Serial.printf("Total Cell Voltage Sum: %.3fV\n", totalCellVoltage/1000.0);
-    
-    // Debug: Show cell count discrepancy if any
-    if (actualCellCount != Param::GetInt(Param::CellsPresent)) {
-        Serial.printf("⚠️  Cell Count Mismatch: Parameter=%d, Actual=%d (FIXED)\n", 
-            Param::GetInt(Param::CellsPresent), actualCellCount);
-    }
+    // Sum of all present cells, from the same pass that found min and max
+    Serial.printf("Total Cell Voltage Sum: %.3fV\n", cellStats.sum/1000.0);
     
     // Print individual cell voltages with hardware position mapping
     Serial.println("\nIndividual Cell Voltages (Sequential# -> Chip:Register):");
@@ -1065,12 +2081,9 @@ void BATMan::upDateCellVolts(void)
                 }
                 
                 // Check if this cell is being balanced using HARDWARE REGISTER POSITION
-                if(Param::GetInt(Param::balance)) // Check if balancing flag is set
+                if (cellStats.balance[chip] & (1 << reg))
                 {
-                    if((Param::GetFloat(Param::umin) + BalHys) < cellVoltage)
-                    {
-                        Serial.printf(" (BALANCING-Bit%d)", reg);
-                    }
+                    Serial.printf(" (BALANCING-Bit%d)", reg);
                 }
                 
                 Serial.println();
@@ -1103,8 +2116,9 @@ void BATMan::upDateAuxVolts(void)
     Param::SetInt(Param::Chip1_5V,(rev16(Volts5v[0]))/12.5);
     Param::SetInt(Param::Chip2_5V,((Volts5v[1]))/12.5);
 
-    // -AI- Initialize total pack voltage to 0
-    Param::SetFloat(Param::udc,0);
+    // -AI- Total pack voltage is summed locally and published once at the end, so readers on
+    // the other core (the coulomb counter) never see a zeroed or partial udc
+    float packVoltage = 0;
 
     // -AI- Process first BMB module (if present)
     // -AI- Calculate chip voltages and add to total pack voltage
@@ -1114,7 +2128,7 @@ void BATMan::upDateAuxVolts(void)
         Param::SetFloat(Param::ChipV1,ChipV[0]*0.001280);
         Param::SetFloat(Param::ChipV2,ChipV[1]*0.001280);
         // -AI- Add both chip voltages to total pack voltage
-        Param::SetFloat(Param::udc,(Param::GetFloat(Param::ChipV1)+Param::GetFloat(Param::ChipV2)));
+        packVoltage += Param::GetFloat(Param::ChipV1)+Param::GetFloat(Param::ChipV2);
     }
 
     // -AI- Process second BMB module (if present)
@@ -1125,7 +2139,7 @@ void BATMan::upDateAuxVolts(void)
         Param::SetFloat(Param::ChipV3,ChipV[2]*0.001280);
         Param::SetFloat(Param::ChipV4,ChipV[3]*0.001280);
         // -AI- Add both chip voltages to running total
-        Param::SetFloat(Param::udc,(Param::GetFloat(Param::udc)+Param::GetFloat(Param::ChipV3)+Param::GetFloat(Param::ChipV4)));
+        packVoltage += Param::GetFloat(Param::ChipV3)+Param::GetFloat(Param::ChipV4);
     }
 
     // -AI- Process third BMB module (if present)
@@ -1136,7 +2150,7 @@ void BATMan::upDateAuxVolts(void)
         Param::SetFloat(Param::ChipV5,ChipV[4]*0.001280);
         Param::SetFloat(Param::ChipV6,ChipV[5]*0.001280);
         // -AI- Add both chip voltages to running total
-        Param::SetFloat(Param::udc,(Param::GetFloat(Param::udc)+Param::GetFloat(Param::ChipV5)+Param::GetFloat(Param::ChipV6)));
+        packVoltage += Param::GetFloat(Param::ChipV5)+Param::GetFloat(Param::ChipV6);
     }
 
     // -AI- Process fourth BMB module (if present)
@@ -1147,24 +2161,17 @@ void BATMan::upDateAuxVolts(void)
         Param::SetFloat(Param::ChipV7,ChipV[6]*0.001280);
         Param::SetFloat(Param::ChipV8,ChipV[7]*0.001280);
         // -AI- Add both chip voltages to running total
-        Param::SetFloat(Param::udc,(Param::GetFloat(Param::udc)+Param::GetFloat(Param::ChipV7)+Param::GetFloat(Param::ChipV8)));
+        packVoltage += Param::GetFloat(Param::ChipV7)+Param::GetFloat(Param::ChipV8);
     }
+    Param::SetFloat(Param::udc, packVoltage);
 
     // -AI- Calculate average cell voltage from sum of individual cell voltages (more accurate than using pack voltage)
-    // -AI- Dynamically count and sum all present cells
-    float totalCellVoltage = 0;
-    int cellCount = 0;
-    for (int chip = 0; chip < ChipNum; chip++) {
-        for (int reg = 0; reg < 15; reg++) {
-            if (Voltage[chip][reg] > 10) { // Cell is present
-                totalCellVoltage += Voltage[chip][reg];
-                cellCount++;
-            }
-        }
-    }
+    // Sum and count come from the last cell scan's statistics pass
+    uint32_t totalCellVoltage = cellStats.sum;
+    int cellCount = cellStats.count;
     // Calculate average and store in mV
     if (cellCount > 0) {
-        float avgVoltage = totalCellVoltage / cellCount;
+        float avgVoltage = (float)totalCellVoltage / cellCount;
         Param::SetFloat(Param::uavg, avgVoltage);
     } else {
         Param::SetFloat(Param::uavg, 0);
@@ -1177,6 +2184,8 @@ void BATMan::upDateAuxVolts(void)
     Param::SetFloat(Param::chargeVlim,(Param::GetInt(Param::CellVmax)*0.001*cellCount));
     Param::SetFloat(Param::dischargeVlim,(Param::GetInt(Param::CellVmin)*0.001*cellCount));
 
+    if (!reportDue) return;
+
     // Print auxiliary voltage information
     Serial.println("=== Auxiliary Voltage Information ===");
     Serial.printf("Total Pack Voltage: %.2fV\n", Param::GetFloat(Param::udc));
@@ -1219,38 +2228,41 @@ void BATMan::upDateTemps(void)
 
         // -AI- Convert internal temperature sensors to Celsius
         // -AI- Formula: ((ADC value * 0.01) - 40) for both sensors
-        Temp1[g] = ((Temp1[g])*0.01)-40;
-        Temp2[g] = ((Temp2[g])*0.01)-40;
+        // -AI- Raw values stay untouched: 0x4D may not have been re-read since the last pass
+        Temp1C[g] = ((Temp1[g])*0.01f)-40;
+        Temp2C[g] = ((Temp2[g])*0.01f)-40;
 
         // -AI- Track maximum temperature from both sensors
-        if(TempMax < Temp1[g])
+        if(TempMax < Temp1C[g])
         {
-            TempMax = Temp1[g];
+            TempMax = Temp1C[g];
         }
-        if(TempMax < Temp2[g])
+        if(TempMax < Temp2C[g])
         {
-            TempMax = Temp2[g];
+            TempMax = Temp2C[g];
         }
 
         // -AI- Track minimum temperature from both sensors
-        if(TempMin > Temp1[g])
+        if(TempMin > Temp1C[g])
         {
-            TempMin = Temp1[g];
+            TempMin = Temp1C[g];
         }
 
-        if(TempMin > Temp2[g])
+        if(TempMin > Temp2C[g])
         {
-            TempMin = Temp2[g];
+            TempMin = Temp2C[g];
         }
 
         // -AI- Store both temperature sensor values in parameter system
-        Param::SetFloat((Param::PARAM_NUM)(Param::Cellt0_0 + g*2),Temp1[g]);
-        Param::SetFloat((Param::PARAM_NUM)(Param::Cellt0_1 + g*2),Temp2[g]);
+        Param::SetFloat((Param::PARAM_NUM)(Param::Cellt0_0 + g*2),Temp1C[g]);
+        Param::SetFloat((Param::PARAM_NUM)(Param::Cellt0_1 + g*2),Temp2C[g]);
     }
     // -AI- Store overall max and min temperatures in parameter system
     Param::SetFloat(Param::TempMax,TempMax);
     Param::SetFloat(Param::TempMin,TempMin);
 
+    if (!reportDue) return;
+
     // Print temperature information
     Serial.println("=== Temperature Information ===");
     Serial.printf("Max Temperature: %.1f°C\n", TempMax);
@@ -1258,55 +2270,11 @@ void BATMan::upDateTemps(void)
     for (int g = 0; g < ChipNum; g++)
     {
         Serial.printf("Chip %d - Temp1: %.1f°C, Temp2: %.1f°C\n", 
-            g+1, Temp1[g], Temp2[g]);
+            g+1, Temp1C[g], Temp2C[g]);
     }
     Serial.println("=============================\n");
 }
 
-uint8_t BATMan::calcCRC(uint8_t *inData, uint8_t Length)
-{
-    uint8_t CRC8 =  0x10;
-    uint8_t crc_temp = 0;
-    for (uint8_t i = 0; i<Length; i++)
-    {
-        crc_temp = CRC8 ^ inData[i];
-        CRC8 = crcTable2f[crc_temp];
-    }
-    return(CRC8);
-}
-
-void BATMan::crc14_bytes( uint8_t len_B, uint8_t *bytes, uint16_t *crcP )
-{
-    uint8_t pos, idx;
-
-    for ( idx = 0; idx < len_B; idx++ )
-    {
-        pos = (uint8_t)((*crcP >> 6) ^ bytes[idx]);
-
-        *crcP = (uint16_t)( (0x3fff & (*crcP << 8)) ^ (uint16_t)(crc14table[pos]));
-    }
-}
-
-void BATMan::crc14_bits( uint8_t len_b,uint8_t inB, uint16_t *crcP )
-{
-    inB = inB & utilTopN[len_b];   // Mask out the bite we don't care about
-
-    *crcP ^= (uint16_t)((inB) << 6); /* move byte into MSB of 14bit CRC */
-
-    while( len_b-- )
-    {
-        if ((*crcP & 0x2000) != 0) /* test for MSB = bit 13 */
-        {
-            *crcP = (uint16_t)((*crcP << 1) ^ crcPolyBmData);
-        }
-        else
-        {
-            *crcP = (uint16_t)( *crcP << 1);
-        }
-    }
-    *crcP &= 0x3fff;
-}
-
 // Add this function to check SPI communication
 bool BATMan::checkSPIConnection() {
     Serial.println("Checking SPI communication with BMB...");
@@ -1315,7 +2283,7 @@ bool BATMan::checkSPIConnection() {
     Serial.println("Reading Master Batman IC voltages and temperatures...");
     gpio_set_level(BMB_CS, 0);  // CS active low
     uint16_t req = 0x4D;  // Read Aux A register
-    uint16_t response = spi_xfer(BMB_SPI_HOST, req);
+    uint16_t response = spi_word(req);
     gpio_set_level(BMB_CS, 1);  // CS inactive high
     
     // The 5V supply voltage is in word 1 of the response
@@ -1332,7 +2300,7 @@ bool BATMan::checkSPIConnection() {
 
     gpio_set_level(BMB_CS, 0);  // CS active low
     req = 0x4D;  // Read Aux A register
-    response = spi_xfer(BMB_SPI_HOST, req);
+    response = spi_word(req);
     gpio_set_level(BMB_CS, 1);  // CS inactive high
     // Read temperatures
     // LTC6813-1 die temperature calculation:
@@ -1348,7 +2316,7 @@ bool BATMan::checkSPIConnection() {
     // Read chip voltage (from Aux B register)
     gpio_set_level(BMB_CS, 0);  // CS active low
     req = 0x4E;  // Read Aux B register
-    response = spi_xfer(BMB_SPI_HOST, req);
+    response = spi_word(req);
     gpio_set_level(BMB_CS, 1);  // CS inactive high
     
     float chipVoltage = (response & 0xFFFF) * 0.001280;  // Convert to actual voltage
@@ -1378,7 +2346,7 @@ void BATMan::printHardwareMapping() const {
         bool chipHasValidCells = false;
         
         for (int reg = 0; reg < 15; reg++) {
-            uint16_t rawValue = Voltage[chip][reg];
+            uint16_t rawValue = view.Voltage[chip][reg];
             float voltage = rawValue / 1000.0;
             totalRegisters++;
             
@@ -1422,13 +2390,13 @@ void BATMan::printHardwareMapping() const {
     bool foundDamaged = false;
     for (int chip = 0; chip < ChipNum; chip++) {
         for (int reg = 0; reg < 15; reg++) {
-            if (Voltage[chip][reg] <= 10) {
+            if (view.Voltage[chip][reg] <= 10) {
                 if (!foundDamaged) {
                     Serial.println("The following channels are not providing valid readings:");
                     foundDamaged = true;
                 }
                 Serial.printf("  Chip %d, Register %d: %dmV (Expected: >10mV)\n", 
-                    chip, reg, Voltage[chip][reg]);
+                    chip, reg, view.Voltage[chip][reg]);
             }
         }
     }
@@ -1440,79 +2408,75 @@ void BATMan::printHardwareMapping() const {
     Serial.println("============================================\n");
 }
 
-BATMan::BalancingInfo BATMan::getBalancingInfo() const {
-    BalancingInfo info = {0, 0, {0}};
-    int cellCount = 0;
-    int balancingCount = 0;
-    
-    // Check if balancing is enabled
-    if (!Param::GetInt(Param::balance)) {
-        return info;
+void BATMan::printReadTiming() const {
+    Serial.println("\n=== BMB Register Read Timing ===");
+    Serial.printf("Active read path: %s\n", dmaReads ? "DMA frame" : "word-by-word");
+    Serial.println("ReqID   Word-by-word   DMA frame");
+    for (int i = 0; i < BMB_REG_COUNT; i++) {
+        Serial.printf(" 0x%02X   %8luus   %8luus\n", BMB_REG_FIRST + i,
+            (unsigned long)ReadTimeUs[0][i], (unsigned long)ReadTimeUs[1][i]);
     }
-    
-    float minVoltage = Param::GetFloat(Param::umin);
-    float balanceThreshold = minVoltage + BalHys;
-    
-    // Scan through all cells to find which ones SHOULD be balanced
-    // This checks the original balancing logic, not the current phase-masked state
-    for (int chip = 0; chip < 8; chip++) {
-        for (int reg = 0; reg < 15; reg++) {
-            if (Voltage[chip][reg] > 10) { // Cell is present
-                cellCount++;
-                
-                // Check if this cell SHOULD be balanced based on voltage threshold
-                // This is the same logic used in upDateCellVolts() to determine balancing
-                if (Voltage[chip][reg] > balanceThreshold) {
-                    // This cell should be balanced - add it to the list
-                    info.balancingCellNumbers[balancingCount] = cellCount;
-                    balancingCount++;
-                }
-            }
-        }
+    Serial.println("(0us = register not read on that path yet)");
+    Serial.printf("Scan mode: %s, Snap -> fresh cell data: %luus\n",
+        scanMode == BMB_SCAN_BURST ? "burst" : scanMode == BMB_SCAN_SCHEDULED ? "scheduled" : "staged",
+        (unsigned long)SnapLatencyUs);
+    const SyncedMeasurement &sync = view.sync;
+    if (sync.valid) {
+        Serial.printf("Current at Snap: %.3fA, %luus from a real sample (mean %luus, max %luus, %lu unmatched)\n",
+            sync.current, (unsigned long)sync.alignErrUs,
+            (unsigned long)(alignCount ? alignSumUs / alignCount : 0), (unsigned long)alignMaxUs,
+            (unsigned long)alignMisses);
+    } else {
+        Serial.printf("Current at Snap: no match (%lu matched, %lu unmatched)\n",
+            (unsigned long)alignCount, (unsigned long)alignMisses);
     }
-    
-    info.totalCells = cellCount;
-    info.balancingCells = balancingCount;
-    
-    return info;
+    Serial.printf("Busy-wait removed per cycle: %luus (gaps %s)\n", (unsigned long)WaitSavedUs,
+        queuedMode ? "on the SPI queue" : (stepTimer != NULL ? "timed by esp_timer" : "busy-waited - no timer"));
+    Serial.println("================================\n");
 }
 
-void BATMan::updateIndividualCellVoltageParameters(void)
-{
-    // -AI- Update individual cell voltage parameters (u1, u2, u3, etc.) during all phases
-    // This function ensures ESPHome interface gets current voltage data even during balancing phases
-    // WITHOUT doing any balancing calculations or decisions
-    
-    uint8_t Xr = 0; //BMB number
-    uint8_t Yc = 0; //Cell voltage register number
-    uint8_t h = 0;  //Sequential cell index for parameter system
-    
-    // -AI- Process all cells across all BMB chips - ONLY update parameters, no balancing logic
-    while (h <= 108)
-    {
-        if(Yc < 15) //Check actual measurement present (include register 14)
-        {
-            if(Voltage[Xr][Yc] > 10) //Check actual measurement present
-            {
-                // -AI- Update individual cell voltage parameter in parameter system
-                // This ensures ESPHome interface gets current voltage data during all phases
-                Param::SetFloat((Param::PARAM_NUM)(Param::u1 + h), (Voltage[Xr][Yc]));
-                
-                h++; //next cell spot value along
-            }
-            Yc++; //next cell along
-        }
-        else
-        {
-            Yc = 0; //reset Cell column
-            Xr++; //next BMB
-        }
+void BATMan::getBalanceMap(BalanceMap &map) const {
+    memset(&map, 0, sizeof(map));
+
+    // The balance bits are those the last measurement scan computed, i.e. which cells SHOULD
+    // be balanced, not the current phase-masked state
+    bool enabled = Param::GetInt(Param::balance) != 0;
+    memcpy(map.present, view.stats.present, sizeof(map.present));
+    map.totalCells = view.stats.count;
+    if (enabled) {
+        memcpy(map.balance, view.stats.balance, sizeof(map.balance));
+        map.balancingCells = view.stats.balancing;
+    }
+}
 
-        if(Xr == ChipNum)
-        {
-            h = 108; // Exit loop
+size_t BATMan::BalanceMap::formatList(char *buf, size_t len) const {
+    size_t n = 0;
+    if (len == 0) return 0;
+    buf[0] = '\0';
+    Cursor c;
+    for (int cell = next(c); cell != 0; cell = next(c)) {
+        int w = snprintf(buf + n, len - n, n ? ",%d" : "%d", cell);
+        if (w < 0 || (size_t)w >= len - n) {
+            buf[n] = '\0';   // drop a number that does not fit whole
             break;
         }
+        n += w;
+    }
+    return n;
+}
+
+size_t BATMan::BalanceMap::formatHex(char *buf, size_t len) const {
+    static const char digits[] = "0123456789abcdef";
+    uint8_t nibbles[BMB_BALANCE_HEX_LEN - 1] = {0};
+    Cursor c;
+    for (int cell = next(c); cell != 0 && cell <= 108; cell = next(c)) {
+        nibbles[(cell - 1) >> 2] |= 1 << ((cell - 1) & 3);
+    }
+    size_t n = 0;
+    for (int i = BMB_BALANCE_HEX_LEN - 2; i >= 0 && n + 1 < len; i--) {
+        buf[n++] = digits[nibbles[i]];
     }
+    if (len) buf[n] = '\0';
+    return n;
 }
 
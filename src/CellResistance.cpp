@@ -0,0 +1,175 @@
+#include "../include/CellResistance.h"
+#include "../include/Param.h"
+#include <math.h>
+#include <string.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+CellResistance::CellResistance()
+    : cellCount(0), invert(false), haveRef(false), refCurrent(0), refMs(0), steps(0), smallSteps(0),
+      misaligned(0), stale(0), resets(0)
+{
+    reset();
+}
+
+void CellResistance::configure(bool inv)
+{
+    if (inv != invert)
+    {
+        invert = inv;
+        reset();
+        resets++;
+    }
+}
+
+void CellResistance::reset()
+{
+    for (int i = 0; i < RINT_CELLS; i++)
+    {
+        cell[i].r = 0;
+        cell[i].p = RINT_P0;
+        cell[i].refMv = 0;
+        cell[i].updates = 0;
+    }
+    haveRef = false;
+}
+
+void CellResistance::update(const uint16_t *mv, uint8_t cells, const SyncedMeasurement &sync, uint32_t timeMs)
+{
+    if (cells > RINT_CELLS)
+    {
+        cells = RINT_CELLS;
+    }
+    if (cells != cellCount)
+    {
+        // Cells appeared or dropped out: sequential numbers no longer mean the same cells
+        cellCount = cells;
+        reset();
+        resets++;
+    }
+    if (!sync.valid || sync.alignErrUs > RINT_MAX_ALIGN_US)
+    {
+        // No current to pair with these voltages; the next good snapshot starts over
+        misaligned++;
+        haveRef = false;
+        return;
+    }
+    float current = invert ? -sync.current : sync.current;
+
+    if (haveRef && timeMs - refMs > RINT_MAX_GAP_MS)
+    {
+        stale++;
+        haveRef = false;
+    }
+    if (!haveRef)
+    {
+        for (uint8_t i = 0; i < cellCount; i++)
+        {
+            cell[i].refMv = mv[i];
+        }
+        refCurrent = current;
+        refMs = timeMs;
+        haveRef = true;
+        return;
+    }
+
+    // Hold the reference through small changes so a step that ramps over a few snapshots
+    // still counts once in full
+    float dI = current - refCurrent;
+    if (fabsf(dI) < RINT_MIN_STEP_A)
+    {
+        smallSteps++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < cellCount; i++)
+    {
+        Cell &c = cell[i];
+        float dV = (float)((int32_t)mv[i] - (int32_t)c.refMv);
+        float k = c.p * dI / (RINT_FORGET + dI * c.p * dI);
+        c.r += k * (dV - dI * c.r);
+        c.p = (c.p - k * dI * c.p) / RINT_FORGET;
+        // Steps only come when there is excitation, but keep P bounded anyway
+        if (c.p > RINT_P0)
+        {
+            c.p = RINT_P0;
+        }
+        if (c.updates < 255)
+        {
+            c.updates++;
+        }
+        c.refMv = mv[i];
+    }
+    refCurrent = current;
+    refMs = timeMs;
+    steps++;
+}
+
+float CellResistance::resistance(uint8_t n) const
+{
+    if (n < 1 || n > cellCount || cell[n - 1].updates < RINT_MIN_UPDATES)
+    {
+        return 0;
+    }
+    // A noisy start can dip below zero; that is not a resistance
+    return cell[n - 1].r > 0 ? cell[n - 1].r : 0;
+}
+
+void CellResistance::publish() const
+{
+    float maxR = 0;
+    int maxCell = 0;
+    float sum = 0;
+    int valid = 0;
+
+    Param::BeginBatch();
+    for (int i = 0; i < RINT_CELLS; i++)
+    {
+        float r = resistance(i + 1);
+        Param::SetFloat((Param::PARAM_NUM)(Param::r1 + i), r);
+        if (i < cellCount && cell[i].updates >= RINT_MIN_UPDATES)
+        {
+            sum += r;
+            valid++;
+            if (r > maxR)
+            {
+                maxR = r;
+                maxCell = i + 1;
+            }
+        }
+    }
+    Param::SetFloat(Param::Rmax, maxR);
+    Param::SetInt(Param::RmaxCell, maxCell);
+    Param::SetFloat(Param::Ravg, valid ? sum / valid : 0);
+    Param::EndBatch();
+}
+
+#ifdef ARDUINO
+void CellResistance::printStatus(HardwareSerial &serialPort) const
+{
+    serialPort.println("\n=== Cell Resistance ===");
+    serialPort.printf("Cells: %d, steps applied: %lu\n", cellCount, (unsigned long)steps);
+    serialPort.printf("Skipped: %lu below %.0f A, %lu misaligned, %lu stale reference, %lu resets\n",
+        (unsigned long)smallSteps, RINT_MIN_STEP_A, (unsigned long)misaligned, (unsigned long)stale,
+        (unsigned long)resets);
+    int shown = 0;
+    for (uint8_t i = 0; i < cellCount; i++)
+    {
+        if (cell[i].updates < RINT_MIN_UPDATES)
+        {
+            continue;
+        }
+        serialPort.printf("%3d:%6.3f%s", i + 1, resistance(i + 1), (++shown % 8) ? "  " : "\n");
+    }
+    if (shown == 0)
+    {
+        serialPort.printf("No estimates yet - needs current steps of at least %.0f A", RINT_MIN_STEP_A);
+    }
+    if (shown % 8 != 0 || shown == 0)
+    {
+        serialPort.println();
+    }
+    serialPort.println("=======================\n");
+}
+#endif
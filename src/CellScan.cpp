@@ -0,0 +1,113 @@
+#include "../include/CellScan.h"
+#include <string.h>
+
+// --- Scalar ---
+
+static inline void scanOne(uint16_t v, size_t i, uint16_t threshold, CellScanResult &out,
+                           uint16_t &vmin, uint16_t &vmax, uint32_t *mask) {
+    if (v <= CELL_ABSENT_MV) return;
+    out.count++;
+    out.sum += v;
+    if (v < vmin) vmin = v;
+    if (v > vmax) vmax = v;
+    if (v > threshold) {
+        out.above++;
+        if (mask) mask[i >> 5] |= 1u << (i & 31);
+    }
+}
+
+void CellScan::scalar(const uint16_t *v, size_t n, uint16_t threshold, CellScanResult &out, uint32_t *mask) {
+    memset(&out, 0, sizeof(out));
+    if (mask) memset(mask, 0, ((n + 31) / 32) * sizeof(uint32_t));
+    uint16_t vmin = 0xFFFF, vmax = 0;
+    for (size_t i = 0; i < n; i++) {
+        scanOne(v[i], i, threshold, out, vmin, vmax, mask);
+    }
+    out.min = out.count ? vmin : 0;
+    out.max = vmax;
+}
+
+// --- SWAR: two 16-bit lanes per 32-bit word ---
+//
+// Every lane value is <= 0x7FFF, so bit 15 of each lane is free as a guard: (a | H) - b cannot
+// borrow out of a lane, and the guard bit survives exactly when a >= b.
+
+static const uint32_t LANE_GUARD = 0x80008000u;
+static const uint32_t LANE_ONES = 0x00010001u;
+static const uint32_t LANE_VALUE = 0x7FFF7FFFu;
+
+// Guard bit set in each lane where a >= b
+static inline uint32_t laneGe(uint32_t a, uint32_t b) {
+    return ((a | LANE_GUARD) - b) & LANE_GUARD;
+}
+
+// Guard bits -> 0xFFFF in each flagged lane
+static inline uint32_t laneMask(uint32_t ge) {
+    return (ge >> 15) * 0xFFFFu;
+}
+
+void CellScan::swar(const uint16_t *v, size_t n, uint16_t threshold, CellScanResult &out, uint32_t *mask) {
+    memset(&out, 0, sizeof(out));
+    if (mask) memset(mask, 0, ((n + 31) / 32) * sizeof(uint32_t));
+    uint16_t smin = 0xFFFF, smax = 0;
+    size_t i = 0;
+
+    // Word loads need 4-byte alignment on Xtensa; peel one cell if the array starts mid-word
+    if (n && ((uintptr_t)v & 2)) {
+        scanOne(v[0], 0, threshold, out, smin, smax, mask);
+        i = 1;
+    }
+
+    const uint32_t present = (CELL_ABSENT_MV + 1) * LANE_ONES;
+    // Nothing can be above a threshold at or past the largest code
+    const bool anyAbove = threshold < CELL_SCAN_MAX_CODE;
+    const uint32_t above = anyAbove ? (uint32_t)(threshold + 1) * LANE_ONES : 0;
+    uint32_t vmin = LANE_VALUE, vmax = 0, sumLo = 0, sumHi = 0;
+    uint32_t count = 0, aboveCount = 0;
+
+    for (; i + 1 < n; i += 2) {
+        uint32_t w;
+        memcpy(&w, __builtin_assume_aligned(v + i, 4), sizeof(w));
+
+        uint32_t pm = laneMask(laneGe(w, present));
+        uint32_t x = w & pm;                        // absent lanes -> 0
+        count += __builtin_popcount(pm & LANE_ONES);
+        sumLo += x & 0xFFFF;
+        sumHi += x >> 16;
+
+        uint32_t xmin = x | (~pm & LANE_VALUE);     // absent lanes -> largest code
+        vmin ^= (vmin ^ xmin) & laneMask(laneGe(vmin, xmin));
+        vmax ^= (vmax ^ x) & laneMask(laneGe(x, vmax));
+
+        if (anyAbove) {
+            uint32_t a = laneGe(w, above) & pm;
+            if (a) {
+                uint32_t bits = ((a >> 15) & 1) | ((a >> 30) & 2);
+                aboveCount += __builtin_popcount(bits);
+                if (mask) {
+                    // i is odd when the first cell was peeled, so the pair can straddle two words
+                    mask[i >> 5] |= (bits & 1) << (i & 31);
+                    mask[(i + 1) >> 5] |= (bits >> 1) << ((i + 1) & 31);
+                }
+            }
+        }
+    }
+
+    if (i < n) {
+        scanOne(v[i], i, threshold, out, smin, smax, mask);
+    }
+
+    out.count += count;
+    out.above += aboveCount;
+    out.sum += sumLo + sumHi;
+
+    uint16_t lo = vmin & 0xFFFF, hi = vmin >> 16;
+    uint16_t m = lo < hi ? lo : hi;
+    if (smin < m) m = smin;
+    out.min = out.count ? m : 0;
+
+    lo = vmax & 0xFFFF;
+    hi = vmax >> 16;
+    m = lo > hi ? lo : hi;
+    out.max = smax > m ? smax : m;
+}
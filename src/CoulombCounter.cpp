@@ -0,0 +1,185 @@
+#include "../include/CoulombCounter.h"
+#include "../include/Param.h"
+#include "../include/ParamStore.h"
+#include <math.h>
+#include <string.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+CoulombCounter::CoulombCounter()
+    : capacity(0), invert(false), remaining(0), chargeIn(0), chargeOut(0), prevUs(0), havePrev(false),
+      samples(0), restored(false), lastCheckpointMs(0), checkpointSoc(0), checkpointThroughput(0),
+      checkpoints(0)
+{
+    memset(&energyIn, 0, sizeof(energyIn));
+    memset(&energyOut, 0, sizeof(energyOut));
+}
+
+void CoulombCounter::configure(float capacityAh, bool inv)
+{
+    int64_t newCapacity = (int64_t)llroundf(capacityAh * 1000.0f) * (CC_MAUS_PER_AH / 1000);
+    if (capacity == 0)
+    {
+        // First configuration: start from the default SOC until something better is known
+        remaining = (int64_t)(newCapacity * (double)(CC_DEFAULT_SOC / 100.0f));
+    }
+    capacity = newCapacity;
+    invert = inv;
+    // A smaller capacity keeps the Ah remaining, up to full
+    if (remaining > capacity)
+    {
+        remaining = capacity;
+    }
+}
+
+bool CoulombCounter::begin()
+{
+    Checkpoint cp;
+    restored = ParamStore::loadBlob(CC_CHECKPOINT_KEY, &cp, sizeof(cp)) && cp.version == CC_CHECKPOINT_VERSION;
+    if (restored)
+    {
+        remaining = cp.remaining < 0 ? 0 : (cp.remaining > capacity ? capacity : cp.remaining);
+        chargeIn = cp.chargeIn;
+        chargeOut = cp.chargeOut;
+        energyIn.lo = cp.energyInLo;
+        energyIn.hi = cp.energyInHi;
+        energyOut.lo = cp.energyOutLo;
+        energyOut.hi = cp.energyOutHi;
+    }
+    checkpointSoc = soc();
+    checkpointThroughput = chargeIn + chargeOut;
+    return restored;
+}
+
+void CoulombCounter::addSamples(const CurrentSample *s, uint32_t n, float packV)
+{
+    // Pack voltage moves slowly next to the current, one value per batch is plenty
+    uint64_t mV = packV > 0 ? (uint64_t)lroundf(packV * 1000.0f) : 0;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (!havePrev)
+        {
+            // The first sample only fixes the start of the first interval
+            prevUs = s[i].timeUs;
+            havePrev = true;
+            continue;
+        }
+        uint32_t dt = s[i].timeUs - prevUs;     // Wraps cleanly at 2^32 us
+        prevUs = s[i].timeUs;
+        if (dt > CC_MAX_GAP_US)
+        {
+            dt = CC_MAX_GAP_US;
+        }
+
+        int32_t mA = (int32_t)lroundf(s[i].current * 1000.0f);
+        if (invert)
+        {
+            mA = -mA;
+        }
+        int64_t q = (int64_t)mA * dt;
+        remaining += q;
+        if (mA >= 0)
+        {
+            chargeIn += q;
+            energyIn.add(mV * (uint32_t)mA * dt);
+        }
+        else
+        {
+            chargeOut -= q;
+            energyOut.add(mV * (uint32_t)(-mA) * dt);
+        }
+        samples++;
+    }
+
+    // Coulomb counting has no notion of full or empty; the capacity bounds it
+    if (remaining > capacity)
+    {
+        remaining = capacity;
+    }
+    else if (remaining < 0)
+    {
+        remaining = 0;
+    }
+}
+
+void CoulombCounter::setSoc(float pct)
+{
+    if (pct < 0) pct = 0;
+    if (pct > 100) pct = 100;
+    remaining = (int64_t)(capacity * (double)(pct / 100.0f));
+}
+
+float CoulombCounter::soc() const
+{
+    return capacity > 0 ? (float)(remaining * 100.0 / capacity) : 0;
+}
+
+void CoulombCounter::publish() const
+{
+    Param::BeginBatch();
+    Param::SetFloat(Param::SOC, soc());
+    Param::SetFloat(Param::AhRemain, remainingAh());
+    Param::SetFloat(Param::AhIn, chargeIn / (double)CC_MAUS_PER_AH);
+    Param::SetFloat(Param::AhOut, chargeOut / (double)CC_MAUS_PER_AH);
+    Param::SetFloat(Param::WhIn, energyIn.wh());
+    Param::SetFloat(Param::WhOut, energyOut.wh());
+    Param::EndBatch();
+}
+
+void CoulombCounter::loop(uint32_t nowMs)
+{
+    uint32_t since = nowMs - lastCheckpointMs;
+    if (since < CC_CHECKPOINT_MIN_MS)
+    {
+        return;
+    }
+    bool moved = fabsf(soc() - checkpointSoc) >= CC_CHECKPOINT_SOC_STEP;
+    bool changed = chargeIn + chargeOut != checkpointThroughput;
+    if (moved || (changed && since >= CC_CHECKPOINT_MAX_MS))
+    {
+        checkpoint(nowMs);
+    }
+}
+
+bool CoulombCounter::checkpoint(uint32_t nowMs)
+{
+    Checkpoint cp;
+    memset(&cp, 0, sizeof(cp));
+    cp.version = CC_CHECKPOINT_VERSION;
+    cp.remaining = remaining;
+    cp.chargeIn = chargeIn;
+    cp.chargeOut = chargeOut;
+    cp.energyInLo = energyIn.lo;
+    cp.energyInHi = energyIn.hi;
+    cp.energyOutLo = energyOut.lo;
+    cp.energyOutHi = energyOut.hi;
+
+    // Retried after CC_CHECKPOINT_MIN_MS if the write fails
+    lastCheckpointMs = nowMs;
+    if (!ParamStore::saveBlob(CC_CHECKPOINT_KEY, &cp, sizeof(cp)))
+    {
+        return false;
+    }
+    checkpointSoc = soc();
+    checkpointThroughput = chargeIn + chargeOut;
+    checkpoints++;
+    return true;
+}
+
+#ifdef ARDUINO
+void CoulombCounter::printStatus(HardwareSerial &serialPort) const
+{
+    serialPort.println("\n=== Coulomb Counter ===");
+    serialPort.printf("SOC: %.2f%% (%.3f of %.1f Ah)%s\n", soc(), remainingAh(),
+        capacity / (float)CC_MAUS_PER_AH, restored ? "" : " - no checkpoint, default start");
+    serialPort.printf("Charge in/out: %.3f / %.3f Ah\n",
+        chargeIn / (double)CC_MAUS_PER_AH, chargeOut / (double)CC_MAUS_PER_AH);
+    serialPort.printf("Energy in/out: %.1f / %.1f Wh\n", energyIn.wh(), energyOut.wh());
+    serialPort.printf("Samples integrated: %lu, sign: %s\n", (unsigned long)samples,
+        invert ? "discharge positive" : "charge positive");
+    serialPort.printf("Checkpoints: %lu, last at SOC %.2f%%\n", (unsigned long)checkpoints, checkpointSoc);
+    serialPort.println("=======================\n");
+}
+#endif
@@ -0,0 +1,317 @@
+#include "../include/CurrentSampler.h"
+#include <esp_timer.h>
+#include <math.h>
+#include <string.h>
+
+// Indexed by the PGA_CTL_REG D[7:6] code
+static const uint8_t pgaGain[4] = {5, 25, 40, 100};
+static const float pgaRangeMv[4] = {150, 40, 20, 10};   // Input range at each gain (datasheet)
+
+static uint8_t gainToIndex(uint8_t gain)
+{
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (pgaGain[i] == gain)
+        {
+            return i;
+        }
+    }
+    return 1;   // The chip's default, 25
+}
+
+CurrentSampler::CurrentSampler(AS8510 &sensor, uint8_t baseGain)
+    : sensor(sensor), historySeq(0), historyCount(0), task(NULL), sensorMutex(NULL), intPin(0), edgeUs(0),
+      edges(0), lateEdges(0), polled(0), samples(0), firstUs(0), lastUs(0), maxReadUs(0), autoRange(false),
+      baseGain(baseGain), baseIndex(gainToIndex(baseGain)), gainIndex(baseIndex), settle(0), quiet(0),
+      shuntOhm(0), gainChanges(0), saturations(0), settleDrops(0)
+{
+    memset(samplesAtGain, 0, sizeof(samplesAtGain));
+}
+
+uint8_t CurrentSampler::gain() const
+{
+    return pgaGain[gainIndex];
+}
+
+bool CurrentSampler::begin(uint8_t pin)
+{
+    if (task != NULL)
+    {
+        return true;
+    }
+    intPin = pin;
+    shuntOhm = sensor.getShuntResistance();
+    sensorMutex = xSemaphoreCreateRecursiveMutex();
+    if (sensorMutex == NULL)
+    {
+        Serial.println("AS8510 sampler: mutex creation failed - staying on polled reads");
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(taskMain, "as8510", CURRENT_TASK_STACK, this, CURRENT_TASK_PRIORITY,
+                                &task, CURRENT_TASK_CORE) != pdPASS)
+    {
+        task = NULL;
+        Serial.println("AS8510 sampler task creation failed - staying on polled reads");
+        return false;
+    }
+    // INT is active high and held until the result is read
+    pinMode(intPin, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(intPin), dataReadyIsr, this, RISING);
+    Serial.printf("AS8510 sampler started on core %d, data ready on GPIO %d\n", CURRENT_TASK_CORE, intPin);
+    return true;
+}
+
+void IRAM_ATTR CurrentSampler::dataReadyIsr(void *arg)
+{
+    CurrentSampler *self = (CurrentSampler *)arg;
+    BaseType_t woken = pdFALSE;
+    self->edgeUs = (uint32_t)esp_timer_get_time();
+    vTaskNotifyGiveFromISR(self->task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void CurrentSampler::taskMain(void *arg)
+{
+    CurrentSampler *self = (CurrentSampler *)arg;
+
+    for (;;)
+    {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CURRENT_POLL_MS));
+        if (pending > 0)
+        {
+            self->edges += pending;
+            // Two edges before one read: the earlier conversion was overwritten on the chip
+            self->lateEdges += pending - 1;
+            self->readSample(self->edgeUs);
+            continue;
+        }
+
+        // No edge: the INT line may not be fitted, or a result was ready before the ISR was
+        // attached (INT then stays high and never edges again until it is read)
+        self->lockSensor();
+        bool ready = self->sensor.isInitialized() && self->sensor.isDataReady();
+        self->unlockSensor();
+        if (ready)
+        {
+            self->polled++;
+            self->readSample((uint32_t)esp_timer_get_time());
+        }
+    }
+}
+
+void CurrentSampler::readSample(uint32_t timeUs)
+{
+    CurrentSample sample;
+    sample.timeUs = timeUs;
+
+    lockSensor();
+    if (!sensor.isInitialized())
+    {
+        unlockSensor();
+        return;
+    }
+    uint8_t index = gainIndex;
+    sample.gain = pgaGain[index];
+    sample.current = sensor.getCurrent() * baseGain / sample.gain;
+
+    bool keep = settle == 0;
+    if (!keep)
+    {
+        // Converted while the PGA and decimation filter were still settling on the new gain
+        settle--;
+        settleDrops++;
+    }
+    else if (autoRange)
+    {
+        bool saturated = (sensor.readRegister(CURRENT_STATUS2_REG) & 0x80) != 0;
+        rangeStep(sample.current, saturated);
+    }
+    else if (index != baseIndex)
+    {
+        setGainIndex(baseIndex);
+    }
+    unlockSensor();
+
+    if (!keep)
+    {
+        return;
+    }
+    samplesAtGain[index]++;
+    ring.push(sample);
+
+    uint32_t n = historyCount.load(std::memory_order_relaxed);
+    historySeq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    history[n & (CURRENT_HISTORY - 1)] = sample;
+    historyCount.store(n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    historySeq.fetch_add(1, std::memory_order_release);
+
+    uint32_t readUs = (uint32_t)esp_timer_get_time() - timeUs;
+    if (readUs > maxReadUs)
+    {
+        maxReadUs = readUs;
+    }
+    if (samples == 0)
+    {
+        firstUs = timeUs;
+    }
+    lastUs = timeUs;
+    samples++;
+}
+
+float CurrentSampler::fullScale(uint8_t index) const
+{
+    return pgaRangeMv[index] / 1000.0f / shuntOhm;
+}
+
+void CurrentSampler::rangeStep(float amps, bool saturated)
+{
+    if (shuntOhm <= 0)
+    {
+        return;
+    }
+    float magnitude = fabsf(amps);
+    if (saturated)
+    {
+        saturations++;
+    }
+
+    if (saturated || magnitude > CURRENT_RANGE_UP * fullScale(gainIndex))
+    {
+        // Clipped readings understate the current, so saturation goes straight to the lowest gain
+        uint8_t index = 0;
+        if (!saturated)
+        {
+            index = gainIndex;
+            while (index > 0 && magnitude > CURRENT_RANGE_DOWN * fullScale(index))
+            {
+                index--;
+            }
+        }
+        if (index != gainIndex)
+        {
+            setGainIndex(index);
+        }
+        quiet = 0;
+        return;
+    }
+
+    if (gainIndex < 3 && magnitude < CURRENT_RANGE_DOWN * fullScale(gainIndex + 1))
+    {
+        if (++quiet >= CURRENT_RANGE_HOLD)
+        {
+            setGainIndex(gainIndex + 1);
+        }
+    }
+    else
+    {
+        quiet = 0;
+    }
+}
+
+void CurrentSampler::setGainIndex(uint8_t index)
+{
+    uint8_t reg = sensor.readRegister(CURRENT_PGA_REG);
+    sensor.writeRegister(CURRENT_PGA_REG, (reg & 0x3F) | (index << 6));
+    gainIndex = index;
+    settle = CURRENT_SETTLE_SAMPLES;
+    quiet = 0;
+    gainChanges++;
+}
+
+bool CurrentSampler::currentAt(uint32_t timeUs, float &amps, uint32_t &errUs) const
+{
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        uint32_t before = historySeq.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        uint32_t n = historyCount.load(std::memory_order_relaxed);
+        uint32_t oldest = n > CURRENT_HISTORY ? n - CURRENT_HISTORY : 0;
+        bool found = false;
+        float a = 0;
+        uint32_t err = 0;
+
+        // Newest first: a snapshot is usually matched within a few hundred ms of the event
+        for (uint32_t i = n; i > oldest; i--)
+        {
+            CurrentSample older = history[(i - 1) & (CURRENT_HISTORY - 1)];
+            uint32_t since = timeUs - older.timeUs;
+            if ((int32_t)since < 0)
+            {
+                continue;
+            }
+            if (i == n)
+            {
+                // Past the newest sample: hold it
+                a = older.current;
+                err = since;
+            }
+            else
+            {
+                CurrentSample newer = history[i & (CURRENT_HISTORY - 1)];
+                uint32_t span = newer.timeUs - older.timeUs;
+                uint32_t until = span - since;
+                a = span ? older.current + (newer.current - older.current) * ((float)since / span) : older.current;
+                err = since < until ? since : until;
+            }
+            found = true;
+            break;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (historySeq.load(std::memory_order_relaxed) == before)
+        {
+            if (found)
+            {
+                amps = a;
+                errUs = err;
+            }
+            return found;
+        }
+    }
+    return false;
+}
+
+void CurrentSampler::lockSensor()
+{
+    if (sensorMutex != NULL)
+    {
+        xSemaphoreTakeRecursive(sensorMutex, portMAX_DELAY);
+    }
+}
+
+void CurrentSampler::unlockSensor()
+{
+    if (sensorMutex != NULL)
+    {
+        xSemaphoreGiveRecursive(sensorMutex);
+    }
+}
+
+void CurrentSampler::printStatus(HardwareSerial &serialPort) const
+{
+    serialPort.println("\n=== AS8510 Sampler ===");
+    if (task == NULL)
+    {
+        serialPort.println("Not running - current is read by polling from the main loop");
+        serialPort.println("======================\n");
+        return;
+    }
+    float rateHz = (samples > 1 && lastUs != firstUs) ? (samples - 1) * 1e6f / (uint32_t)(lastUs - firstUs) : 0;
+    serialPort.printf("Data ready GPIO %d: %lu edges, %lu late (sample lost), %lu polled reads\n",
+        intPin, (unsigned long)edges, (unsigned long)lateEdges, (unsigned long)polled);
+    serialPort.printf("Samples: %lu at %.1f Hz average, longest edge-to-queue %lu us\n",
+        (unsigned long)samples, rateHz, (unsigned long)maxReadUs);
+    serialPort.printf("Ring: %lu/%lu queued, %lu dropped (consumer too slow)\n",
+        (unsigned long)ring.size(), (unsigned long)ring.capacity(), (unsigned long)ring.dropped());
+    serialPort.printf("Gain: %d (%s, full scale %.1f A), %lu switches, %lu settling samples dropped, %lu saturated\n",
+        gain(), autoRange ? "auto" : "fixed", shuntOhm > 0 ? fullScale(gainIndex) : 0.0f,
+        (unsigned long)gainChanges, (unsigned long)settleDrops, (unsigned long)saturations);
+    serialPort.printf("Samples at gain 5/25/40/100: %lu / %lu / %lu / %lu\n", (unsigned long)samplesAtGain[0],
+        (unsigned long)samplesAtGain[1], (unsigned long)samplesAtGain[2], (unsigned long)samplesAtGain[3]);
+    serialPort.println("======================\n");
+}
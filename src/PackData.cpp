@@ -0,0 +1,158 @@
+#include "../include/PackData.h"
+#include <string.h>
+
+const BmbRegLayout PackData::cellRegLayout[5] = {
+    // reqID firstCell words stride bigEndian scaleMul scaleDiv
+    {0x47,  0,  3, 9, false, 2, 25},  // Read A: cells 1-3
+    {0x48,  3,  3, 9, false, 2, 25},  // Read B: cells 4-6
+    {0x49,  6,  3, 9, false, 2, 25},  // Read C: cells 7-9
+    {0x4A,  9,  3, 9, false, 2, 25},  // Read D: cells 10-12
+    {0x4B, 12,  3, 9, false, 2, 25},  // Read E: cells 13-15
+};
+
+// Raw counts are 80 uV, so mV = raw * 2 / 25, which truncates exactly like the old raw / 12.5
+// float division
+void PackData::decodeCellFrame(const uint8_t *frame, const BmbRegLayout &layout, uint16_t pecOk,
+                               uint8_t chips, uint16_t (*out)[15])
+{
+    if (chips > 8) chips = 8;
+
+    for (int h = 0; h < chips; h++)
+    {
+        if (!(pecOk & (1 << h))) continue;
+        const uint8_t *block = frame + h * layout.stride;
+        uint16_t *cells = &out[h][layout.firstCell];
+
+        for (int g = 0; g < layout.words; g++)
+        {
+            uint16_t raw = layout.bigEndian ? (uint16_t)((block[2 * g] << 8) | block[2 * g + 1])
+                                            : (uint16_t)((block[2 * g + 1] << 8) | block[2 * g]);
+            if (raw != 0xffff)
+            {
+                cells[g] = (uint16_t)(((uint32_t)raw * layout.scaleMul) / layout.scaleDiv);
+            }
+        }
+    }
+}
+
+static uint16_t isqrt32(uint32_t v)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > v)
+    {
+        bit >>= 2;
+    }
+    while (bit)
+    {
+        if (v >= root + bit)
+        {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+void PackData::packStats(const uint16_t volts[8][15], uint8_t chips, uint16_t balanceAbove, PackStats &out)
+{
+    memset(&out, 0, sizeof(out));
+    uint64_t sumSq = 0;
+    uint16_t min = 0xFFFF;
+    uint16_t max = 0;
+    if (chips > 8)
+    {
+        chips = 8;
+    }
+
+    for (uint8_t chip = 0; chip < chips; chip++)
+    {
+        uint16_t present = 0;
+        uint16_t balance = 0;
+        for (uint8_t reg = 0; reg < 15; reg++)
+        {
+            uint16_t v = volts[chip][reg];
+            if (v <= 10) // No measurement in this slot
+            {
+                continue;
+            }
+            present |= 1 << reg;
+            out.count++;
+            out.sum += v;
+            sumSq += (uint32_t)v * v;
+            // First occurrence wins on ties, as the old scans did
+            if (v < min)
+            {
+                min = v;
+                out.minCell = out.count;
+                out.minChip = chip;
+                out.minReg = reg;
+            }
+            if (v > max)
+            {
+                max = v;
+                out.maxCell = out.count;
+                out.maxChip = chip;
+                out.maxReg = reg;
+            }
+            if (v > balanceAbove)
+            {
+                balance |= 1 << reg;
+                out.balancing++;
+            }
+        }
+        out.present[chip] = present;
+        out.balance[chip] = balance;
+    }
+
+    if (out.count)
+    {
+        out.min = min;
+        out.max = max;
+        out.mean = (uint16_t)((out.sum + out.count / 2) / out.count);
+        // n^2 * variance = n * sum(v^2) - sum(v)^2, exact in 64 bits
+        uint64_t n2var = (uint64_t)out.count * sumSq - (uint64_t)out.sum * out.sum;
+        out.stdDev = isqrt32((uint32_t)(n2var / ((uint64_t)out.count * out.count)));
+    }
+}
+
+void CellMap::clear()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+bool CellMap::update(const uint16_t newPresent[8])
+{
+    if (memcmp(newPresent, present, sizeof(present)) == 0)
+    {
+        return false;
+    }
+
+    memcpy(present, newPresent, sizeof(present));
+    memset(slotOfCell, 0, sizeof(slotOfCell));
+    uint8_t cell = 0;
+    for (int chip = 0; chip < 8; chip++)
+    {
+        for (int reg = 0; reg < 15; reg++)
+        {
+            if (present[chip] & (1 << reg))
+            {
+                cell++;
+                cellOfSlot[chip][reg] = cell;
+                slotOfCell[cell] = (uint8_t)((chip << 4) | reg);
+            }
+            else
+            {
+                cellOfSlot[chip][reg] = 0;
+            }
+        }
+    }
+    cells = cell;
+    rebuilds++;
+    return true;
+}
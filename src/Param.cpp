@@ -1,323 +1,617 @@
 #include "../include/Param.h"
-#include <map>
-#include <Arduino.h>
 #include <cstring>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+#include <atomic>
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+// Registry table generated from PARAM_LIST, indexed by PARAM_NUM
+#define PARAM_INFO_ENTRY(name, type, unit, min, max, def, deadband, group, desc) \
+    { #name, Param::TYPE_##type, unit, min, max, def, deadband, Param::GROUP_##group, desc },
+static constexpr Param::Info paramInfo[] = {
+    PARAM_LIST(PARAM_INFO_ENTRY)
+};
+#undef PARAM_INFO_ENTRY
+
+#define PARAM_GROUP_TITLE(group, title) title,
+static const char* const groupTitles[] = {
+    PARAM_GROUP_LIST(PARAM_GROUP_TITLE)
+};
+#undef PARAM_GROUP_TITLE
+
+static constexpr int paramInfoCount = sizeof(paramInfo) / sizeof(paramInfo[0]);
+
+static constexpr bool namesEqual(const char* a, const char* b) {
+    while (*a && *a == *b) { a++; b++; }
+    return *a == *b;
+}
+
+static constexpr bool namesUnique() {
+    for (int i = 0; i < paramInfoCount; i++) {
+        for (int j = i + 1; j < paramInfoCount; j++) {
+            if (namesEqual(paramInfo[i].name, paramInfo[j].name)) return false;
+        }
+    }
+    return true;
+}
+
+static constexpr bool defaultsInRange() {
+    for (int i = 0; i < paramInfoCount; i++) {
+        const Param::Info& p = paramInfo[i];
+        if (p.type == Param::TYPE_STRING) continue;
+        if (p.min > p.max || p.def < p.min || p.def > p.max) return false;
+        if (p.type == Param::TYPE_INT && p.def != (float)(int32_t)p.def) return false;
+        if (p.deadband < 0 || p.deadband > p.max - p.min) return false;
+    }
+    return true;
+}
+
+static_assert(paramInfoCount == Param::PARAM_COUNT, "paramInfo must have one entry per PARAM_NUM");
+static_assert(sizeof(groupTitles) / sizeof(groupTitles[0]) == Param::GROUP_COUNT, "one title per group");
+static_assert(namesUnique(), "parameter names must be unique");
+static_assert(defaultsInRange(), "parameter defaults must lie within min..max");
+// Code indexes these blocks as base + offset
+static_assert(Param::u108 - Param::u1 == 107, "u1..u108 must be consecutive");
+static_assert(Param::Chipt7 - Param::Chipt0 == 7, "Chipt0..Chipt7 must be consecutive");
+static_assert(Param::Cellt0_1 - Param::Cellt0_0 == 1 && Param::Cellt7_1 - Param::Cellt0_0 == 15,
+              "CelltN_0/CelltN_1 must be interleaved per chip");
+static_assert(Param::ChipV8 - Param::ChipV1 == 7, "ChipV1..ChipV8 must be consecutive");
+static_assert(Param::Chip8Cells - Param::Chip1Cells == 7, "Chip1Cells..Chip8Cells must be consecutive");
+static_assert(Param::r108 - Param::r1 == 107, "r1..r108 must be consecutive");
+static_assert(Param::ScanCellsPri - Param::ScanCellsMs == 6 && Param::ScanStatusPri - Param::ScanCellsPri == 5,
+              "scan periods and priorities must be consecutive");
+
+// Name lookup: a perfect hash built at compile time (hash and displace). The case-folded FNV-1a
+// hash of a name picks a bucket; each bucket has a displacement, found by the constructor below,
+// that sends every name in it to its own slot. A lookup is one hash, one table read and one compare.
+#define PARAM_HASH_SLOT_BITS 9
+#define PARAM_HASH_SLOTS     (1 << PARAM_HASH_SLOT_BITS)
+#define PARAM_HASH_BUCKETS   128
+
+static constexpr char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static constexpr uint32_t nameHash(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h = (h ^ (uint8_t)foldCase(*name++)) * 16777619u;
+    }
+    return h;
+}
+
+static constexpr uint32_t hashSlot(uint32_t h, uint16_t displace) {
+    return ((h ^ (displace * 0x9E3779B9u)) * 0x85EBCA6Bu) >> (32 - PARAM_HASH_SLOT_BITS);
+}
+
+struct ParamNameIndex {
+    uint16_t displace[PARAM_HASH_BUCKETS];
+    int16_t slot[PARAM_HASH_SLOTS];     // PARAM_NUM, or -1 for an empty slot
+    bool ok;
+
+    constexpr ParamNameIndex() : displace(), slot(), ok(true) {
+        uint32_t hash[Param::PARAM_COUNT] = {};
+        int bucketSize[PARAM_HASH_BUCKETS] = {};
+        int largest = 0;
+        for (int s = 0; s < PARAM_HASH_SLOTS; s++) slot[s] = -1;
+        for (int i = 0; i < Param::PARAM_COUNT; i++) {
+            hash[i] = nameHash(paramInfo[i].name);
+            int n = ++bucketSize[hash[i] % PARAM_HASH_BUCKETS];
+            if (n > largest) largest = n;
+        }
+
+        // Place the fullest buckets first while the table is still empty
+        for (int size = largest; size > 0; size--) {
+            for (int b = 0; b < PARAM_HASH_BUCKETS; b++) {
+                if (bucketSize[b] != size) continue;
+                bool placed = false;
+                for (uint32_t d = 0; d < 0x10000 && !placed; d++) {
+                    placed = true;
+                    for (int i = 0; i < Param::PARAM_COUNT && placed; i++) {
+                        if (hash[i] % PARAM_HASH_BUCKETS != (uint32_t)b) continue;
+                        uint32_t s = hashSlot(hash[i], (uint16_t)d);
+                        if (slot[s] >= 0) placed = false;
+                        else slot[s] = (int16_t)i;
+                    }
+                    if (!placed) {
+                        // Undo this attempt's claims
+                        for (int s = 0; s < PARAM_HASH_SLOTS; s++) {
+                            if (slot[s] >= 0 && hash[slot[s]] % PARAM_HASH_BUCKETS == (uint32_t)b) slot[s] = -1;
+                        }
+                    }
+                    else {
+                        displace[b] = (uint16_t)d;
+                    }
+                }
+                if (!placed) ok = false;
+            }
+        }
+    }
+
+    constexpr int find(const char* name) const {
+        uint32_t h = nameHash(name);
+        return slot[hashSlot(h, displace[h % PARAM_HASH_BUCKETS])];
+    }
+};
+
+static constexpr ParamNameIndex paramNameIndex{};
+
+static constexpr bool indexComplete() {
+    for (int i = 0; i < paramInfoCount; i++) {
+        if (paramNameIndex.find(paramInfo[i].name) != i) return false;
+    }
+    return true;
+}
+
+static constexpr bool namesUniqueNoCase() {
+    for (int i = 0; i < paramInfoCount; i++) {
+        for (int j = i + 1; j < paramInfoCount; j++) {
+            const char* a = paramInfo[i].name;
+            const char* b = paramInfo[j].name;
+            while (*a && foldCase(*a) == foldCase(*b)) { a++; b++; }
+            if (foldCase(*a) == foldCase(*b)) return false;
+        }
+    }
+    return true;
+}
+
+static_assert(Param::PARAM_COUNT * 5 <= PARAM_HASH_SLOTS * 4, "raise PARAM_HASH_SLOT_BITS for the parameter count");
+static_assert(paramNameIndex.ok && indexComplete(), "no perfect hash found for the parameter names");
+static_assert(namesUniqueNoCase(), "parameter names must differ in more than case");
+static_assert(paramNameIndex.find("as8510_temp") == Param::as8510_temp &&
+              paramNameIndex.find("AS8510_TEMP") == Param::as8510_temp, "name lookup");
 
-// Storage for parameters
-static std::map<Param::PARAM_NUM, int> intParams;
-static std::map<Param::PARAM_NUM, float> floatParams;
-static std::map<Param::PARAM_NUM, String> stringParams;
-
-// Parameter name mapping
-static const char* paramNames[] = {
-    // System parameters
-    "numbmbs", "LoopCnt", "LoopState", "CellsPresent", "CellsBalancing", "BalanceCellList",
-    
-    // Cell voltage parameters
-    "u1", "u2", "u3", "u4", "u5", "u6", "u7", "u8", "u9", "u10",
-    "u11", "u12", "u13", "u14", "u15", "u16", "u17", "u18", "u19", "u20",
-    "u21", "u22", "u23", "u24", "u25", "u26", "u27", "u28", "u29", "u30",
-    "u31", "u32", "u33", "u34", "u35", "u36", "u37", "u38", "u39", "u40",
-    "u41", "u42", "u43", "u44", "u45", "u46", "u47", "u48", "u49", "u50",
-    "u51", "u52", "u53", "u54", "u55", "u56", "u57", "u58", "u59", "u60",
-    "u61", "u62", "u63", "u64", "u65", "u66", "u67", "u68", "u69", "u70",
-    "u71", "u72", "u73", "u74", "u75", "u76", "u77", "u78", "u79", "u80",
-    "u81", "u82", "u83", "u84", "u85", "u86", "u87", "u88", "u89", "u90",
-    "u91", "u92", "u93", "u94", "u95", "u96", "u97", "u98", "u99", "u100",
-    "u101", "u102", "u103", "u104", "u105", "u106", "u107", "u108",
-    
-    // Voltage statistics
-    "CellMax", "CellMin", "umax", "umin", "deltaV", "udc", "uavg", "chargeVlim", "dischargeVlim",
-    
-    // Balance control
-    "balance", "CellVmax", "CellVmin",
-    
-    // Temperature parameters
-    "Chipt0", "Cellt0_0", "Cellt0_1", "TempMax", "TempMin",
-    
-    // Chip voltages
-    "ChipV1", "ChipV2", "ChipV3", "ChipV4", "ChipV5", "ChipV6", "ChipV7", "ChipV8",
-    
-    // Chip supplies
-    "Chip1_5V", "Chip2_5V",
-    
-    // Cell counts per chip
-    "Chip1Cells", "Chip2Cells", "Chip3Cells", "Chip4Cells",
-    
-    // AS8510 Current Sensor parameters
-    "current", "as8510_temp"
+// Storage for parameters: one slot per PARAM_NUM, statically allocated. The storage type of
+// each slot is fixed by the registry; setters convert between int and float.
+union ParamSlot {
+    int32_t i;
+    float f;
+    int32_t str;   // index into stringPool
 };
 
-// Initialize default values
+#define PARAM_STRING_SLOTS 2
+#define PARAM_STRING_LEN   32    // stored text (BalanceMap: 27 hex digits)
+#define PARAM_TEXT_LEN     448   // rendered text (BalanceCellList for 108 cells: "1,2,...,108")
+
+static constexpr int stringParamCount() {
+    int n = 0;
+    for (int i = 0; i < paramInfoCount; i++) {
+        if (paramInfo[i].type == Param::TYPE_STRING) n++;
+    }
+    return n;
+}
+static_assert(stringParamCount() <= PARAM_STRING_SLOTS, "raise PARAM_STRING_SLOTS for the STRING parameters");
+
+static ParamSlot slots[Param::PARAM_COUNT];
+static char stringPool[PARAM_STRING_SLOTS][PARAM_STRING_LEN];
+static uint8_t stringPoolUsed = 0;
+static Param::TextRenderer stringRender[PARAM_STRING_SLOTS];
+
+// Change tracking: the value each parameter had at its last counted change, and the sequence
+// number of that change. Sequence numbers start at 1, so "changes since 0" lists everything.
+static ParamSlot reported[Param::PARAM_COUNT];
+static uint32_t changedAt[Param::PARAM_COUNT];
+static uint32_t changeSeq = 1;
+
+static inline bool validParam(Param::PARAM_NUM param) {
+    return param >= 0 && param < Param::PARAM_COUNT;
+}
+
+static inline Param::Type typeOf(Param::PARAM_NUM param) {
+    return paramInfo[param].type;
+}
+
+// Concurrency: writers (BMB acquisition task, serial commands, main loop) are serialised by a
+// spinlock held only for the store itself, so no writer ever blocks on a reader. Readers take no
+// lock but can block: paramSeq is odd while any write or batch is open, a multi-parameter read
+// waits for it to be even and retries until it saw the same value before and after its copy.
+#ifdef ARDUINO
+static portMUX_TYPE paramMux = portMUX_INITIALIZER_UNLOCKED;
+static inline void lockStore() { portENTER_CRITICAL(&paramMux); }
+static inline void unlockStore() { portEXIT_CRITICAL(&paramMux); }
+static inline void readerSleep() { vTaskDelay(1); }
+#else
+// Host build (native tests): a plain spinlock, and readers yield instead of sleeping a tick
+static std::atomic_flag paramMux = ATOMIC_FLAG_INIT;
+static inline void lockStore() { while (paramMux.test_and_set(std::memory_order_acquire)) {} }
+static inline void unlockStore() { paramMux.clear(std::memory_order_release); }
+static inline void readerSleep() { std::this_thread::yield(); }
+#endif
+static std::atomic<uint32_t> paramSeq(0);
+static uint32_t writeDepth = 0;    // open writes + batches, guarded by paramMux
+
+static inline void openWrite() {
+    if (writeDepth++ == 0) {
+        paramSeq.fetch_add(1, std::memory_order_acq_rel);  // odd: update in progress
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+static inline void closeWrite() {
+    if (--writeDepth == 0) {
+        std::atomic_thread_fence(std::memory_order_release);
+        paramSeq.fetch_add(1, std::memory_order_release);  // even: consistent
+    }
+}
+
+struct ParamWrite {
+    ParamWrite() { lockStore(); openWrite(); }
+    ~ParamWrite() { closeWrite(); unlockStore(); }
+};
+
+// Reader side: wait for an even sequence number. Spins briefly, then sleeps a tick so a
+// lower-priority writer on the same core can finish its batch.
+static inline uint32_t readBegin() {
+    for (int spins = 0; ; spins++) {
+        uint32_t seq = paramSeq.load(std::memory_order_acquire);
+        if (!(seq & 1)) return seq;
+        if (spins >= 64) {
+            readerSleep();
+            spins = 0;
+        }
+    }
+}
+
+static inline bool readRetry(uint32_t seq) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return paramSeq.load(std::memory_order_relaxed) != seq;
+}
+
+// Count a write as a change once it has moved the value by at least the deadband. Caller holds paramMux.
+static inline void noteInt(Param::PARAM_NUM param, int32_t value) {
+    int32_t diff = value - reported[param].i;
+    if (diff < 0) diff = -diff;
+    if (diff == 0 || diff < paramInfo[param].deadband) return;
+    reported[param].i = value;
+    changedAt[param] = ++changeSeq;
+}
+
+static inline void noteFloat(Param::PARAM_NUM param, float value) {
+    float diff = fabsf(value - reported[param].f);
+    if (diff == 0.0f || diff < paramInfo[param].deadband) return;
+    reported[param].f = value;
+    changedAt[param] = ++changeSeq;
+}
+
+// Initialize default values from the registry
 static void initParams() {
-    intParams[Param::numbmbs] = 1;  // Set default number of BMBs to 1
-    intParams[Param::balance] = 0;  // Balance disabled by default
-    intParams[Param::LoopCnt] = 0;
-    intParams[Param::LoopState] = 0;
-    intParams[Param::CellsPresent] = 0;
-    intParams[Param::CellsBalancing] = 0;
-    
-    // Initialize string parameters
-    stringParams[Param::BalanceCellList] = "";
-    
-    // Initialize all cell voltages to 0
-    for (int i = Param::u1; i <= Param::u108; i++) {
-        intParams[static_cast<Param::PARAM_NUM>(i)] = 0;
-    }
-    
-    // Initialize voltage statistics
-    intParams[Param::CellMax] = 0;
-    intParams[Param::CellMin] = 0;
-    intParams[Param::umax] = 0;
-    intParams[Param::umin] = 0;
-    intParams[Param::deltaV] = 0;
-    intParams[Param::udc] = 0;
-    intParams[Param::uavg] = 0;
-    intParams[Param::chargeVlim] = 0;
-    intParams[Param::dischargeVlim] = 0;
-    
-    // Initialize balance control
-    intParams[Param::CellVmax] = 0;
-    intParams[Param::CellVmin] = 0;
-    
-    // Initialize temperature parameters
-    intParams[Param::Chipt0] = 0;
-    intParams[Param::Cellt0_0] = 0;
-    intParams[Param::Cellt0_1] = 0;
-    intParams[Param::TempMax] = 0;
-    intParams[Param::TempMin] = 0;
-    
-    // Initialize chip voltages
-    intParams[Param::ChipV1] = 0;
-    intParams[Param::ChipV2] = 0;
-    intParams[Param::ChipV3] = 0;
-    intParams[Param::ChipV4] = 0;
-    intParams[Param::ChipV5] = 0;
-    intParams[Param::ChipV6] = 0;
-    intParams[Param::ChipV7] = 0;
-    intParams[Param::ChipV8] = 0;
-    
-    // Initialize chip supplies
-    intParams[Param::Chip1_5V] = 0;
-    intParams[Param::Chip2_5V] = 0;
-    
-    // Initialize cell counts per chip
-    intParams[Param::Chip1Cells] = 0;
-    intParams[Param::Chip2Cells] = 0;
-    intParams[Param::Chip3Cells] = 0;
-    intParams[Param::Chip4Cells] = 0;
-    
-    // Initialize AS8510 Current Sensor parameters
-    floatParams[Param::current] = 0.0f;
-    floatParams[Param::as8510_temp] = 0.0f;
+    for (int i = 0; i < Param::PARAM_COUNT; i++) {
+        const Param::Info& p = paramInfo[i];
+        changedAt[i] = changeSeq;
+        if (p.type == Param::TYPE_STRING) {
+            slots[i].str = -1;
+            if (stringPoolUsed < PARAM_STRING_SLOTS) {
+                slots[i].str = stringPoolUsed++;
+                stringPool[slots[i].str][0] = '\0';
+            }
+        }
+        else if (p.type == Param::TYPE_FLOAT) {
+            slots[i].f = p.def;
+        }
+        else {
+            slots[i].i = (int32_t)p.def;
+        }
+        reported[i] = slots[i];
+    }
 }
 
+const Param::Info* Param::GetInfo(PARAM_NUM param) {
+    return validParam(param) ? &paramInfo[param] : nullptr;
+}
+
+// A single slot is one aligned 32-bit word, so single-parameter reads need no retry loop
 int Param::GetInt(PARAM_NUM param) {
-    return intParams[param];
+    if (!validParam(param)) return 0;
+    switch (typeOf(param)) {
+        case TYPE_INT:   return slots[param].i;
+        case TYPE_FLOAT: return (int)slots[param].f;
+        default:         return 0;
+    }
 }
 
 void Param::SetInt(PARAM_NUM param, int value) {
-    intParams[param] = value;
+    if (!validParam(param)) return;
+    ParamWrite write;
+    if (typeOf(param) == TYPE_INT) {
+        slots[param].i = value;
+        noteInt(param, value);
+    }
+    else if (typeOf(param) == TYPE_FLOAT) {
+        slots[param].f = (float)value;
+        noteFloat(param, (float)value);
+    }
 }
 
 float Param::GetFloat(PARAM_NUM param) {
-    return floatParams[param];
+    if (!validParam(param)) return 0.0f;
+    switch (typeOf(param)) {
+        case TYPE_INT:   return (float)slots[param].i;
+        case TYPE_FLOAT: return slots[param].f;
+        default:         return 0.0f;
+    }
 }
 
 void Param::SetFloat(PARAM_NUM param, float value) {
-    floatParams[param] = value;
+    if (!validParam(param)) return;
+    ParamWrite write;
+    if (typeOf(param) == TYPE_FLOAT) {
+        slots[param].f = value;
+        noteFloat(param, value);
+    }
+    else if (typeOf(param) == TYPE_INT) {
+        slots[param].i = (int32_t)lroundf(value);
+        noteInt(param, slots[param].i);
+    }
 }
 
-String Param::GetString(PARAM_NUM param) {
-    return stringParams[param];
+size_t Param::GetString(PARAM_NUM param, char* buf, size_t len) {
+    if (len == 0) return 0;
+    buf[0] = '\0';
+    if (!validParam(param) || typeOf(param) != TYPE_STRING || slots[param].str < 0) return 0;
+    TextRenderer render = stringRender[slots[param].str];
+    if (render) {
+        return render(buf, len);
+    }
+    char copy[PARAM_STRING_LEN];
+    uint32_t seq;
+    do {
+        seq = readBegin();
+        memcpy(copy, stringPool[slots[param].str], PARAM_STRING_LEN);
+    } while (readRetry(seq));
+    copy[PARAM_STRING_LEN - 1] = '\0';
+    return snprintf(buf, len, "%s", copy);
 }
 
-void Param::SetString(PARAM_NUM param, const String& value) {
-    stringParams[param] = value;
+void Param::SetString(PARAM_NUM param, const char* value) {
+    if (!validParam(param) || typeOf(param) != TYPE_STRING || slots[param].str < 0) return;
+    ParamWrite write;
+    char* str = stringPool[slots[param].str];
+    if (strncmp(str, value, PARAM_STRING_LEN - 1) != 0) {
+        snprintf(str, PARAM_STRING_LEN, "%s", value);
+        changedAt[param] = ++changeSeq;
+    }
+}
+
+void Param::SetRenderer(PARAM_NUM param, TextRenderer render) {
+    if (!validParam(param) || typeOf(param) != TYPE_STRING || slots[param].str < 0) return;
+    stringRender[slots[param].str] = render;
+}
+
+void Param::BeginBatch() {
+    lockStore();
+    openWrite();
+    unlockStore();
+}
+
+void Param::EndBatch() {
+    lockStore();
+    closeWrite();
+    unlockStore();
+}
+
+uint32_t Param::ReadFloats(PARAM_NUM first, int count, float* out) {
+    if (first < 0 || count < 0 || first + count > PARAM_COUNT) return 0;
+    uint32_t seq;
+    do {
+        seq = readBegin();
+        for (int i = 0; i < count; i++) {
+            const ParamSlot& slot = slots[first + i];
+            out[i] = (typeOf((PARAM_NUM)(first + i)) == TYPE_INT) ? (float)slot.i : slot.f;
+        }
+    } while (readRetry(seq));
+    return seq;
+}
+
+uint32_t Param::ReadFloats(const PARAM_NUM* params, int count, float* out) {
+    for (int i = 0; i < count; i++) {
+        if (!validParam(params[i])) return 0;
+    }
+    uint32_t seq;
+    do {
+        seq = readBegin();
+        for (int i = 0; i < count; i++) {
+            const ParamSlot& slot = slots[params[i]];
+            out[i] = (typeOf(params[i]) == TYPE_INT) ? (float)slot.i : slot.f;
+        }
+    } while (readRetry(seq));
+    return seq;
+}
+
+uint32_t Param::GetChangeSeq() {
+    return __atomic_load_n(&changeSeq, __ATOMIC_ACQUIRE);
+}
+
+uint32_t Param::ChangesSince(uint32_t seq, uint32_t* bitmap) {
+    uint32_t now, rseq;
+    do {
+        rseq = readBegin();
+        memset(bitmap, 0, BITMAP_WORDS * sizeof(uint32_t));
+        for (int i = 0; i < PARAM_COUNT; i++) {
+            // Wrap-safe "changedAt > seq"
+            if ((int32_t)(changedAt[i] - seq) > 0) {
+                bitmap[i >> 5] |= 1u << (i & 31);
+            }
+        }
+        now = changeSeq;
+    } while (readRetry(rseq));
+    return now;
+}
+
+size_t Param::StorageBytes() {
+    return sizeof(slots) + sizeof(stringPool) + sizeof(reported) + sizeof(changedAt);
 }
 
 const char* Param::GetParamName(PARAM_NUM param) {
-    if (param >= 0 && param < sizeof(paramNames) / sizeof(paramNames[0])) {
-        return paramNames[param];
+    if (validParam(param)) {
+        return paramInfo[param].name;
     }
     return "unknown";
 }
 
 Param::PARAM_NUM Param::GetParamFromName(const char* name) {
-    for (int i = 0; i < sizeof(paramNames) / sizeof(paramNames[0]); i++) {
-        if (strcmp(paramNames[i], name) == 0) {
-            return static_cast<PARAM_NUM>(i);
-        }
+    int i = paramNameIndex.find(name);
+    if (i >= 0 && strcmp(paramInfo[i].name, name) == 0) {
+        return static_cast<PARAM_NUM>(i);
     }
     return static_cast<PARAM_NUM>(-1); // Invalid parameter
 }
 
-void Param::PrintAllParams() {
-    Serial.println("\n=== All Parameters ===");
-    for (int i = 0; i < sizeof(paramNames) / sizeof(paramNames[0]); i++) {
-        PrintParam(static_cast<PARAM_NUM>(i));
+Param::PARAM_NUM Param::GetParamFromNameNoCase(const char* name) {
+    int i = paramNameIndex.find(name);
+    if (i >= 0 && strcasecmp(paramInfo[i].name, name) == 0) {
+        return static_cast<PARAM_NUM>(i);
     }
-    Serial.println("=====================\n");
+    return static_cast<PARAM_NUM>(-1); // Invalid parameter
+}
+
+// --- Arduino String and serial API. The native test build has neither. ---
+
+#ifdef ARDUINO
+String Param::GetString(PARAM_NUM param) {
+    char text[PARAM_TEXT_LEN];
+    GetString(param, text, sizeof(text));
+    return String(text);
+}
+
+void Param::SetString(PARAM_NUM param, const String& value) {
+    SetString(param, value.c_str());
+}
+
+// The Serial overloads forward to the port versions; Serial is a HardwareSerial on the ESP32
+void Param::PrintAllParams() {
+    PrintAllParams(Serial);
 }
 
 void Param::PrintParam(PARAM_NUM param) {
-    const char* name = GetParamName(param);
-    if (strcmp(name, "unknown") == 0) {
-        Serial.printf("Parameter %d: INVALID\n", param);
-        return;
-    }
-    
-    // Check if parameter exists in stringParams
-    if (stringParams.find(param) != stringParams.end()) {
-        Serial.printf("%s=%s\n", name, stringParams[param].c_str());
-    }
-    // Check if parameter exists in intParams
-    else if (intParams.find(param) != intParams.end()) {
-        Serial.printf("%s=%d\n", name, intParams[param]);
-    }
-    // Check if parameter exists in floatParams
-    else if (floatParams.find(param) != floatParams.end()) {
-        Serial.printf("%s=%.3f\n", name, floatParams[param]);
-    }
-    else {
-        Serial.printf("%s=<not set>\n", name);
-    }
+    PrintParam(param, Serial);
 }
 
 bool Param::SetParamFromString(const char* name, const char* value) {
-    PARAM_NUM param = GetParamFromName(name);
-    if (param == static_cast<PARAM_NUM>(-1)) {
-        Serial.printf("Error: Unknown parameter '%s'\n", name);
-        return false;
-    }
-    
-    // Try to parse as integer first
-    char* endptr;
-    long intValue = strtol(value, &endptr, 10);
-    if (*endptr == '\0') {
-        // Successfully parsed as integer
-        SetInt(param, intValue);
-        Serial.printf("Set %s = %d\n", name, intValue);
-        return true;
-    }
-    
-    // Try to parse as float
-    float floatValue = strtof(value, &endptr);
-    if (*endptr == '\0') {
-        // Successfully parsed as float
-        SetFloat(param, floatValue);
-        Serial.printf("Set %s = %.3f\n", name, floatValue);
-        return true;
-    }
-    
-    Serial.printf("Error: Could not parse value '%s' for parameter '%s'\n", value, name);
-    return false;
+    return SetParamFromString(name, value, Serial);
 }
 
 void Param::PrintParamHelp() {
-    Serial.println("\n=== Parameter API Help ===");
-    Serial.println("Commands:");
-    Serial.println("  param list                    - List all parameters");
-    Serial.println("  param get <name>              - Get parameter value");
-    Serial.println("  param set <name> <value>      - Set parameter value");
-    Serial.println("  param help                    - Show this help");
-    Serial.println("");
-    Serial.println("Examples:");
-    Serial.println("  param get balance             - Get balance status");
-    Serial.println("  param set balance 1           - Enable balance");
-    Serial.println("  param set numbmbs 2           - Set number of BMBs to 2");
-    Serial.println("  param set u1 4200             - Set cell 1 voltage to 4200mV");
-    Serial.println("  param set ChipV1 3.3          - Set chip 1 voltage to 3.3V");
-    Serial.println("");
-    Serial.println("Parameter Categories:");
-    Serial.println("  System: numbmbs, LoopCnt, LoopState, CellsPresent, CellsBalancing");
-    Serial.println("  Cell Voltages: u1-u108 (cell voltages in mV)");
-    Serial.println("  Voltage Stats: CellMax, CellMin, umax, umin, deltaV, udc, uavg");
-    Serial.println("  Balance: balance, CellVmax, CellVmin");
-    Serial.println("  Temperature: Chipt0, Cellt0_0, Cellt0_1, TempMax, TempMin");
-    Serial.println("  Chip Voltages: ChipV1-ChipV8");
-    Serial.println("  Chip Supplies: Chip1_5V, Chip2_5V");
-    Serial.println("  Cell Counts: Chip1Cells, Chip2Cells, Chip3Cells, Chip4Cells");
-    Serial.println("");
-    Serial.println("Common Parameters:");
-    Serial.println("  balance     - Balance control (0=off, 1=on)");
-    Serial.println("  numbmbs     - Number of BMB boards");
-    Serial.println("  u1-u108     - Individual cell voltages in mV");
-    Serial.println("  umax/umin   - Maximum/minimum cell voltages");
-    Serial.println("  deltaV      - Voltage difference between max and min cells");
-    Serial.println("  CellMax/CellMin - Cell numbers with max/min voltage");
-    Serial.println("=======================\n");
+    PrintParamHelp(Serial);
 }
 
 // Overloaded methods for specific serial ports
 void Param::PrintAllParams(HardwareSerial& serialPort) {
     serialPort.println("\n=== All Parameters ===");
-    for (int i = 0; i < sizeof(paramNames) / sizeof(paramNames[0]); i++) {
+    for (int i = 0; i < PARAM_COUNT; i++) {
         PrintParam(static_cast<PARAM_NUM>(i), serialPort);
     }
     serialPort.println("=====================\n");
 }
 
 void Param::PrintParam(PARAM_NUM param, HardwareSerial& serialPort) {
-    const char* name = GetParamName(param);
-    if (strcmp(name, "unknown") == 0) {
+    if (!validParam(param)) {
         serialPort.printf("Parameter %d: INVALID\n", param);
         return;
     }
-    
-    // Check if parameter exists in stringParams
-    if (stringParams.find(param) != stringParams.end()) {
-        serialPort.printf("%s=%s\n", name, stringParams[param].c_str());
-    }
-    // Check if parameter exists in intParams
-    else if (intParams.find(param) != intParams.end()) {
-        serialPort.printf("%s=%d\n", name, intParams[param]);
-    }
-    // Check if parameter exists in floatParams
-    else if (floatParams.find(param) != floatParams.end()) {
-        serialPort.printf("%s=%.3f\n", name, floatParams[param]);
+    const char* name = paramInfo[param].name;
+
+    // Getters copy the value out without blocking writers. The output stays
+    // "name=value" because the ESPHome interface parses exactly that.
+    switch (typeOf(param)) {
+        case TYPE_STRING: {
+            char text[PARAM_TEXT_LEN];
+            GetString(param, text, sizeof(text));
+            serialPort.printf("%s=%s\n", name, text);
+            break;
+        }
+        case TYPE_INT:
+            serialPort.printf("%s=%d\n", name, GetInt(param));
+            break;
+        case TYPE_FLOAT:
+            serialPort.printf("%s=%.3f\n", name, GetFloat(param));
+            break;
     }
-    else {
-        serialPort.printf("%s=<not set>\n", name);
+}
+
+void Param::PrintChangesSince(uint32_t seq, HardwareSerial& serialPort) {
+    uint32_t bitmap[BITMAP_WORDS];
+    uint32_t now = ChangesSince(seq, bitmap);
+    for (int w = 0; w < BITMAP_WORDS; w++) {
+        uint32_t bits = bitmap[w];
+        while (bits) {
+            int i = (w << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+            PrintParam(static_cast<PARAM_NUM>(i), serialPort);
+        }
     }
+    // Pass this back as <seq> on the next call
+    serialPort.printf("changeseq=%u\n", (unsigned)now);
 }
 
 bool Param::SetParamFromString(const char* name, const char* value, HardwareSerial& serialPort) {
-    PARAM_NUM param = GetParamFromName(name);
+    PARAM_NUM param = GetParamFromNameNoCase(name);
     if (param == static_cast<PARAM_NUM>(-1)) {
         serialPort.printf("Error: Unknown parameter '%s'\n", name);
         return false;
     }
-    
-    // Try to parse as integer first
+    const Info& info = paramInfo[param];
+    name = info.name;
+
+    if (info.type == TYPE_STRING) {
+        SetString(param, value);
+        serialPort.printf("Set %s = %s\n", name, value);
+        return true;
+    }
+
     char* endptr;
-    long intValue = strtol(value, &endptr, 10);
-    if (*endptr == '\0') {
-        // Successfully parsed as integer
+    if (info.type == TYPE_INT) {
+        long intValue = strtol(value, &endptr, 10);
+        if (*value == '\0' || *endptr != '\0') {
+            serialPort.printf("Error: '%s' expects an integer, got '%s'\n", name, value);
+            return false;
+        }
+        if (intValue < info.min || intValue > info.max) {
+            serialPort.printf("Error: %s must be within %ld..%ld %s\n", name, (long)info.min, (long)info.max, info.unit);
+            return false;
+        }
         SetInt(param, intValue);
-        serialPort.printf("Set %s = %d\n", name, intValue);
+        serialPort.printf("Set %s = %ld\n", name, intValue);
         return true;
     }
-    
-    // Try to parse as float
+
     float floatValue = strtof(value, &endptr);
-    if (*endptr == '\0') {
-        // Successfully parsed as float
-        SetFloat(param, floatValue);
-        serialPort.printf("Set %s = %.3f\n", name, floatValue);
-        return true;
+    if (*value == '\0' || *endptr != '\0') {
+        serialPort.printf("Error: Could not parse value '%s' for parameter '%s'\n", value, name);
+        return false;
     }
-    
-    serialPort.printf("Error: Could not parse value '%s' for parameter '%s'\n", value, name);
-    return false;
+    // Written so NaN fails too; it compares false against both limits
+    if (!(floatValue >= info.min && floatValue <= info.max)) {
+        serialPort.printf("Error: %s must be within %ld..%ld %s\n", name, (long)info.min, (long)info.max, info.unit);
+        return false;
+    }
+    SetFloat(param, floatValue);
+    serialPort.printf("Set %s = %.3f\n", name, floatValue);
+    return true;
+}
+
+// Consecutive undocumented entries with the same type, unit and range (u1..u108) share one line
+static bool sameRow(const Param::Info& a, const Param::Info& b) {
+    return a.group == b.group && a.type == b.type && a.min == b.min && a.max == b.max &&
+           a.desc[0] == '\0' && b.desc[0] == '\0' && strcmp(a.unit, b.unit) == 0;
 }
 
 void Param::PrintParamHelp(HardwareSerial& serialPort) {
+    static const char* const typeNames[] = { "int", "float", "string" };
+
     serialPort.println("\n=== Parameter API Help ===");
     serialPort.println("Commands:");
     serialPort.println("  param list                    - List all parameters");
     serialPort.println("  param get <name>              - Get parameter value");
     serialPort.println("  param set <name> <value>      - Set parameter value");
+    serialPort.println("  param changes <seq>           - List parameters changed since <seq>, then changeseq=<new seq>");
+    serialPort.println("  param store [flush|erase]     - Persisted config status, commit now, or erase");
     serialPort.println("  param help                    - Show this help");
     serialPort.println("");
     serialPort.println("Examples:");
@@ -327,26 +621,45 @@ void Param::PrintParamHelp(HardwareSerial& serialPort) {
     serialPort.println("  param set u1 4200             - Set cell 1 voltage to 4200mV");
     serialPort.println("  param set ChipV1 3.3          - Set chip 1 voltage to 3.3V");
     serialPort.println("");
-    serialPort.println("Parameter Categories:");
-    serialPort.println("  System: numbmbs, LoopCnt, LoopState, CellsPresent, CellsBalancing");
-    serialPort.println("  Cell Voltages: u1-u108 (cell voltages in mV)");
-    serialPort.println("  Voltage Stats: CellMax, CellMin, umax, umin, deltaV, udc, uavg");
-    serialPort.println("  Balance: balance, CellVmax, CellVmin");
-    serialPort.println("  Temperature: Chipt0, Cellt0_0, Cellt0_1, TempMax, TempMin");
-    serialPort.println("  Chip Voltages: ChipV1-ChipV8");
-    serialPort.println("  Chip Supplies: Chip1_5V, Chip2_5V");
-    serialPort.println("  Cell Counts: Chip1Cells, Chip2Cells, Chip3Cells, Chip4Cells");
-    serialPort.println("");
-    serialPort.println("Common Parameters:");
-    serialPort.println("  balance     - Balance control (0=off, 1=on)");
-    serialPort.println("  numbmbs     - Number of BMB boards");
-    serialPort.println("  u1-u108     - Individual cell voltages in mV");
-    serialPort.println("  umax/umin   - Maximum/minimum cell voltages");
-    serialPort.println("  deltaV      - Voltage difference between max and min cells");
-    serialPort.println("  CellMax/CellMin - Cell numbers with max/min voltage");
+    serialPort.println("Parameters (name  type  range [unit]  default  description):");
+
+    int group = -1;
+    for (int i = 0; i < PARAM_COUNT; ) {
+        const Info& p = paramInfo[i];
+        int last = i;
+        while (last + 1 < PARAM_COUNT && sameRow(p, paramInfo[last + 1])) {
+            last++;
+        }
+
+        if (p.group != group) {
+            group = p.group;
+            serialPort.printf("  %s:\n", groupTitles[group]);
+        }
+
+        char name[40];
+        if (last > i) {
+            snprintf(name, sizeof(name), "%s..%s", p.name, paramInfo[last].name);
+        }
+        else {
+            strlcpy(name, p.name, sizeof(name));
+        }
+
+        if (p.type == TYPE_STRING) {
+            serialPort.printf("    %-16s %-6s %s\n", name, typeNames[p.type], p.desc);
+        }
+        else {
+            char range[32];
+            snprintf(range, sizeof(range), "%ld..%ld%s%s", (long)p.min, (long)p.max,
+                     p.unit[0] ? " " : "", p.unit);
+            serialPort.printf("    %-16s %-6s %-20s %-6g %s\n", name, typeNames[p.type], range, p.def, p.desc);
+        }
+        i = last + 1;
+    }
     serialPort.println("=======================\n");
 }
 
+#endif // ARDUINO
+
 // Call initialization when the program starts
 static struct ParamInitializer {
     ParamInitializer() {
@@ -0,0 +1,237 @@
+#include "../include/ParamStore.h"
+#include <string.h>
+#include <stdio.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#define PARAM_PERSIST_NUM(name) Param::name,
+#define PARAM_PERSIST_KEY(name) #name,
+static const Param::PARAM_NUM persisted[] = { PARAM_PERSIST_LIST(PARAM_PERSIST_NUM) };
+static constexpr const char* persistKeys[] = { PARAM_PERSIST_LIST(PARAM_PERSIST_KEY) };
+#undef PARAM_PERSIST_NUM
+#undef PARAM_PERSIST_KEY
+
+#define PERSIST_COUNT (sizeof(persisted) / sizeof(persisted[0]))
+
+static constexpr bool persistKeysFit() {
+    for (const char* key : persistKeys) {
+        size_t n = 0;
+        while (key[n]) n++;
+        if (n > 15) return false;   // NVS key limit
+    }
+    return true;
+}
+static_assert(persistKeysFit(), "persisted parameter names must fit an NVS key (15 chars)");
+
+// --- NVS backend ---
+
+#ifdef ARDUINO
+
+bool NvsParamBackend::begin(const char* nameSpace) {
+    opened = prefs.begin(nameSpace, false);
+    return opened;
+}
+
+bool NvsParamBackend::load(const char* key, void* data, size_t len) {
+    if (!opened || prefs.getBytesLength(key) != len) return false;
+    return prefs.getBytes(key, data, len) == len;
+}
+
+bool NvsParamBackend::save(const char* key, const void* data, size_t len) {
+    return opened && prefs.putBytes(key, data, len) == len;
+}
+
+bool NvsParamBackend::erase() {
+    return opened && prefs.clear();
+}
+#endif
+
+// --- In-memory backend ---
+
+bool MemoryParamBackend::load(const char* key, void* data, size_t len) {
+    for (uint8_t i = 0; i < used; i++) {
+        if (strcmp(entries[i].key, key) == 0) {
+            if (entries[i].len != len) return false;
+            memcpy(data, entries[i].data, len);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MemoryParamBackend::save(const char* key, const void* data, size_t len) {
+    if (len > PARAM_MEM_DATA_LEN || strlen(key) >= PARAM_MEM_KEY_LEN) return false;
+    uint8_t i = 0;
+    while (i < used && strcmp(entries[i].key, key) != 0) i++;
+    if (i == used) {
+        if (used >= PARAM_MEM_KEYS) return false;
+        snprintf(entries[i].key, PARAM_MEM_KEY_LEN, "%s", key);
+        used++;
+    }
+    memcpy(entries[i].data, data, len);
+    entries[i].len = (uint8_t)len;
+    saves++;
+    return true;
+}
+
+bool MemoryParamBackend::erase() {
+    used = 0;
+    return true;
+}
+
+// --- Store ---
+
+// Everything the store knows
+struct StoreState {
+    ParamBackend* backend;
+    uint32_t stored[PERSIST_COUNT];     // raw 32-bit value last committed per key
+    bool haveStored[PERSIST_COUNT];
+    uint32_t lastSeq;                   // Param change sequence already looked at
+    bool pending;
+    uint32_t firstChangeMs;
+    uint32_t lastChangeMs;
+    uint32_t nowMs;                     // time of the last loop() call
+    uint32_t commits;
+    uint32_t writes;
+    uint32_t loaded;
+};
+
+static StoreState state;
+
+// Parameters are stored as their raw 32-bit slot: int32 for INT, float bits for FLOAT
+static uint32_t rawValue(Param::PARAM_NUM p) {
+    uint32_t raw;
+    if (Param::GetInfo(p)->type == Param::TYPE_FLOAT) {
+        float f = Param::GetFloat(p);
+        memcpy(&raw, &f, sizeof(raw));
+    }
+    else {
+        int32_t i = Param::GetInt(p);
+        memcpy(&raw, &i, sizeof(raw));
+    }
+    return raw;
+}
+
+static bool applyRaw(Param::PARAM_NUM p, uint32_t raw) {
+    const Param::Info* info = Param::GetInfo(p);
+    if (info->type == Param::TYPE_FLOAT) {
+        float f;
+        memcpy(&f, &raw, sizeof(f));
+        if (!(f >= info->min && f <= info->max)) return false;
+        Param::SetFloat(p, f);
+    }
+    else {
+        int32_t i;
+        memcpy(&i, &raw, sizeof(i));
+        if (i < info->min || i > info->max) return false;
+        Param::SetInt(p, i);
+    }
+    return true;
+}
+
+void ParamStore::begin(ParamBackend& backend) {
+    memset(&state, 0, sizeof(state));
+    state.backend = &backend;
+
+    Param::BeginBatch();
+    for (size_t k = 0; k < PERSIST_COUNT; k++) {
+        uint32_t raw;
+        if (backend.load(persistKeys[k], &raw, sizeof(raw))) {
+            // Out-of-range values (registry ranges changed since they were stored) are dropped
+            // and get overwritten with the default on the next commit
+            if (applyRaw(persisted[k], raw)) {
+                state.stored[k] = raw;
+                state.haveStored[k] = true;
+                state.loaded++;
+            }
+        }
+    }
+    Param::EndBatch();
+
+    // What was just loaded is not a change
+    state.lastSeq = Param::GetChangeSeq();
+}
+
+void ParamStore::loop(uint32_t nowMs) {
+    if (!state.backend) return;
+    state.nowMs = nowMs;
+
+    uint32_t changed[Param::BITMAP_WORDS];
+    state.lastSeq = Param::ChangesSince(state.lastSeq, changed);
+    for (size_t k = 0; k < PERSIST_COUNT; k++) {
+        if (changed[persisted[k] >> 5] & (1u << (persisted[k] & 31))) {
+            if (!state.pending) {
+                state.pending = true;
+                state.firstChangeMs = nowMs;
+            }
+            state.lastChangeMs = nowMs;
+            break;
+        }
+    }
+
+    if (state.pending && (nowMs - state.lastChangeMs >= PARAM_STORE_QUIET_MS ||
+                          nowMs - state.firstChangeMs >= PARAM_STORE_MAX_DELAY_MS)) {
+        flush();
+    }
+}
+
+bool ParamStore::flush() {
+    if (!state.backend) return false;
+    bool ok = true;
+    for (size_t k = 0; k < PERSIST_COUNT; k++) {
+        uint32_t raw = rawValue(persisted[k]);
+        if (state.haveStored[k] && state.stored[k] == raw) {
+            continue;   // unchanged: no flash write
+        }
+        if (state.backend->save(persistKeys[k], &raw, sizeof(raw))) {
+            state.stored[k] = raw;
+            state.haveStored[k] = true;
+            state.writes++;
+        }
+        else {
+            ok = false;
+        }
+    }
+    state.commits++;
+    state.pending = !ok;   // retry on the next quiet period if a write failed
+    if (!ok) {
+        state.firstChangeMs = state.lastChangeMs = state.nowMs;
+    }
+    return ok;
+}
+
+bool ParamStore::erase() {
+    if (!state.backend || !state.backend->erase()) return false;
+    memset(state.haveStored, 0, sizeof(state.haveStored));
+    state.pending = false;
+    return true;
+}
+
+bool ParamStore::saveBlob(const char* key, const void* data, size_t len) {
+    if (!state.backend || Param::GetParamFromNameNoCase(key) != static_cast<Param::PARAM_NUM>(-1)) return false;
+    return state.backend->save(key, data, len);
+}
+
+bool ParamStore::loadBlob(const char* key, void* data, size_t len) {
+    if (!state.backend || Param::GetParamFromNameNoCase(key) != static_cast<Param::PARAM_NUM>(-1)) return false;
+    return state.backend->load(key, data, len);
+}
+
+#ifdef ARDUINO
+void ParamStore::printStatus(HardwareSerial& serialPort) {
+    serialPort.println("\n=== Parameter Store ===");
+    serialPort.printf("Backend: %s, %u persisted parameters, %lu loaded at boot\n",
+        state.backend ? "ready" : "none", (unsigned)PERSIST_COUNT, (unsigned long)state.loaded);
+    serialPort.printf("Commits: %lu, key writes: %lu, pending: %s\n",
+        (unsigned long)state.commits, (unsigned long)state.writes, state.pending ? "yes" : "no");
+    serialPort.printf("Commit after %u ms without changes, at most %u ms after the first\n",
+        (unsigned)PARAM_STORE_QUIET_MS, (unsigned)PARAM_STORE_MAX_DELAY_MS);
+    serialPort.print("Persisted:");
+    for (size_t k = 0; k < PERSIST_COUNT; k++) {
+        serialPort.printf(" %s%s", persistKeys[k], state.haveStored[k] ? "" : "*");
+    }
+    serialPort.println("\n(* = not stored yet, default in use)");
+    serialPort.println("=======================\n");
+}
+#endif
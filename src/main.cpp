@@ -1,5 +1,9 @@
 #include <Arduino.h>
 #include "BatMan.h"
+#include "ParamStore.h"
+#include "CurrentSampler.h"
+#include "CoulombCounter.h"
+#include "CellResistance.h"
 // #include <TFT_eSPI.h>  // DISABLED to avoid SPI conflicts
 #include <SPI.h>
 #include "../AS8510-library/as8510.h"
@@ -26,6 +30,7 @@ Available commands:
   */
 
 BATMan batman;
+NvsParamBackend nvsParams;
 // TFT_eSPI tft = TFT_eSPI();  // DISABLED to avoid SPI conflicts
 
 /* Tesla Shunt Debug Header Pinout
@@ -44,6 +49,7 @@ BATMan batman;
 #define AS8510_MISO_PIN 25      // GPIO pin for AS8510 MISO (HSPI)
 #define AS8510_SCK_PIN 32       // GPIO pin for AS8510 SCK (HSPI)
 #define SHUNT_RESISTANCE 0.000025296 // 25296nΩ shunt resistance
+#define AS8510_INT_PIN 34       // GPIO pin for AS8510 data ready (header pin #5, input only)
 
 // Serial Interface Configuration
 #define SERIAL2_RX_PIN 39       // GPIO pin for Serial2 RX
@@ -57,12 +63,21 @@ BATMan batman;
 #define ECONOMIZER_DUTY 15   // Normal duty cycle (25%)
 #define INITIAL_PULSE_TIME 100  // Initial 100% duty cycle time in milliseconds
 
+// BMB acquisition runs in its own FreeRTOS task (see BMB_TASK_CORE); 0 = legacy one state per main loop tick
+#define BMB_ACQUISITION_TASK 1
+
 // Button Configuration
 #define BUTTON_PIN 35        // GPIO pin for push button
 #define DEBOUNCE_TIME 50     // Debounce time in milliseconds
 
 // Current sensor instance - Updated for new Rust-based AS8510 library
 AS8510 currentSensor(26, 33, 25, 32, Gain::Gain100, Gain::Gain25);
+// Reads the sensor on every data-ready interrupt; anything else using currentSensor takes its lock
+CurrentSampler currentSampler(currentSensor, 100);   // Gain100 as constructed above
+// Integrates every current sample into SOC and the Ah/Wh totals
+CoulombCounter coulombCounter;
+// Fits each cell's internal resistance from load steps across snapshots
+CellResistance cellResistance;
 
 // Variables to store previous values for comparison
 float prevMinVoltage = 0;
@@ -74,6 +89,8 @@ uint8_t prevDutyCycle = 0;  // Track duty cycle changes
 // Current measurement variables
 float currentReading = 0;
 float prevCurrentReading = 0;
+float currentPeak = 0;              // Largest |current| since the last 2 s report
+uint32_t currentWindowSamples = 0;  // Samples since the last 2 s report
 bool currentSensorInitialized = false;
 
 // Balance control variable
@@ -109,6 +126,9 @@ HardwareSerial* diagnosticSerial = nullptr;
 void runDiagnosticStep();
 void startAS8510NonBlocking(HardwareSerial& serialPort);
 void processSerialInputs();
+void updateParametersFromBATMan();
+void drainCurrentSamples();
+bool currentAtSnap(uint32_t timeUs, float &amps, uint32_t &errUs);
 
 // Function to process serial commands (now takes a HardwareSerial reference)
 void processSerialCommand(String command, HardwareSerial& serialPort) {
@@ -150,6 +170,70 @@ void processSerialCommand(String command, HardwareSerial& serialPort) {
     else if (lowerCommand == "bmb debug status") {
         serialPort.printf("BMB register debug is: %s\n", BATMan::getRegisterDebug() ? "ENABLED" : "DISABLED");
     }
+    else if (lowerCommand == "bmb dma on") {
+        batman.setDmaReads(true);
+        serialPort.printf("BMB DMA frame reads: %s\n", batman.getDmaReads() ? "ENABLED" : "UNAVAILABLE");
+    }
+    else if (lowerCommand == "bmb dma off") {
+        batman.setDmaReads(false);
+        serialPort.println("BMB DMA frame reads DISABLED - using word-by-word transfers");
+    }
+    else if (lowerCommand == "bmb timing") {
+        batman.printReadTiming();
+    }
+    else if (lowerCommand == "bmb queue on") {
+        batman.setQueuedMode(true);
+        serialPort.printf("BMB queued transactions: %s\n", batman.getQueuedMode() ? "ENABLED" : "UNAVAILABLE");
+    }
+    else if (lowerCommand == "bmb queue off") {
+        batman.setQueuedMode(false);
+        serialPort.println("BMB queued transactions DISABLED - states run synchronously");
+    }
+    else if (lowerCommand == "bmb burst on") {
+        batman.setBurstMode(true);
+        serialPort.println("BMB burst scan ENABLED - full pack scan per cycle");
+    }
+    else if (lowerCommand == "bmb burst off") {
+        batman.setBurstMode(false);
+        serialPort.println("BMB burst scan DISABLED - staged low-power scan");
+    }
+    else if (lowerCommand == "bmb pec on") {
+        batman.setPecCheck(true);
+        serialPort.println("BMB response PEC check ENABLED - bad blocks dropped and re-read (reply layout unverified)");
+    }
+    else if (lowerCommand == "bmb pec off") {
+        batman.setPecCheck(false);
+        serialPort.println("BMB response PEC check DISABLED - errors counted only");
+    }
+    else if (lowerCommand == "bmb pec clear") {
+        batman.clearPecStats();
+        serialPort.println("BMB PEC counters cleared");
+    }
+    else if (lowerCommand == "bmb pec") {
+        batman.printPecStats();
+    }
+    else if (lowerCommand == "bmb spi cal") {
+        batman.requestSpiCalibration();
+        serialPort.println("BMB SPI clock calibration requested - runs at the end of the current cycle");
+    }
+    else if (lowerCommand.startsWith("bmb spi ")) {
+        long hz = lowerCommand.substring(8).toInt();
+        if (hz >= 1000000) {
+            batman.requestSpiClock(hz);
+            serialPort.printf("BMB SPI clock change to %ld Hz requested\n", hz);
+        } else {
+            serialPort.println("Usage: bmb spi <hz> (1000000 or more) | bmb spi cal");
+        }
+    }
+    else if (lowerCommand == "bmb spi") {
+        batman.printSpiClock();
+    }
+    else if (lowerCommand == "bmb sched") {
+        batman.printSchedule();
+    }
+    else if (lowerCommand == "bmb queue") {
+        batman.printQueueTimeline();
+    }
     else if (lowerCommand == "current diag" || lowerCommand == "diag current") {
         if (!diagnosticInProgress) {
             diagnosticInProgress = true;
@@ -164,16 +248,44 @@ void processSerialCommand(String command, HardwareSerial& serialPort) {
     else if (lowerCommand == "start as8510" || lowerCommand == "as8510 start") {
         startAS8510NonBlocking(serialPort);
     }
+    else if (lowerCommand == "as8510 sampler" || lowerCommand == "sampler") {
+        currentSampler.printStatus(serialPort);
+    }
+    else if (lowerCommand == "soc") {
+        coulombCounter.printStatus(serialPort);
+    }
+    else if (lowerCommand.startsWith("soc set ")) {
+        float pct = lowerCommand.substring(8).toFloat();
+        if (pct >= 0 && pct <= 100) {
+            coulombCounter.setSoc(pct);
+            coulombCounter.publish();
+            coulombCounter.checkpoint(millis());
+            serialPort.printf("SOC set to %.1f%% (%.2f Ah)\n", pct, coulombCounter.remainingAh());
+        } else {
+            serialPort.println("Usage: soc set <0-100>");
+        }
+    }
+    else if (lowerCommand == "rint") {
+        cellResistance.printStatus(serialPort);
+    }
+    else if (lowerCommand == "rint reset") {
+        cellResistance.reset();
+        cellResistance.publish();
+        serialPort.println("Cell resistance estimates cleared");
+    }
     else if (lowerCommand == "as8510 errors" || lowerCommand == "errors") {
         serialPort.println("Reading AS8510 error codes...");
+        CurrentSampler::SensorLock lock(currentSampler);
         currentSensor.printErrorCodes();
     }
     else if (lowerCommand == "as8510 saturation" || lowerCommand == "saturation") {
         serialPort.println("Reading AS8510 saturation flags...");
+        CurrentSampler::SensorLock lock(currentSampler);
         currentSensor.printSaturationFlags();
     }
     else if (lowerCommand == "as8510 diagnostics" || lowerCommand == "diagnostics") {
         serialPort.println("Running complete AS8510 diagnostics...");
+        CurrentSampler::SensorLock lock(currentSampler);
         currentSensor.printAllDiagnostics();
     }
     // Parameter API commands
@@ -188,9 +300,23 @@ void processSerialCommand(String command, HardwareSerial& serialPort) {
         else if (lowerParamCommand == "help") {
             Param::PrintParamHelp(serialPort);
         }
+        else if (lowerParamCommand == "store") {
+            ParamStore::printStatus(serialPort);
+        }
+        else if (lowerParamCommand == "store flush") {
+            serialPort.println(ParamStore::flush() ? "Parameters committed" : "Error: commit failed");
+        }
+        else if (lowerParamCommand == "store erase") {
+            serialPort.println(ParamStore::erase() ? "Stored parameters erased, defaults apply from next boot" : "Error: erase failed");
+        }
+        else if (lowerParamCommand.startsWith("changes")) {
+            // Only what changed since the caller's last sequence number (0 = everything)
+            uint32_t seq = (uint32_t)strtoul(paramCommand.substring(7).c_str(), NULL, 10);
+            Param::PrintChangesSince(seq, serialPort);
+        }
         else if (lowerParamCommand.startsWith("get ")) {
-            String paramName = paramCommand.substring(4); // Keep original case for parameter name
-            Param::PARAM_NUM param = Param::GetParamFromName(paramName.c_str());
+            String paramName = paramCommand.substring(4); // Names are matched case-insensitively
+            Param::PARAM_NUM param = Param::GetParamFromNameNoCase(paramName.c_str());
             if (param != static_cast<Param::PARAM_NUM>(-1)) {
                 Param::PrintParam(param, serialPort);
             } else {
@@ -219,9 +345,20 @@ void processSerialCommand(String command, HardwareSerial& serialPort) {
         serialPort.println("  mapping / debug              - Show hardware register mapping");
         serialPort.println("  bmb registers / registers    - Show detailed BMB register analysis");
         serialPort.println("  bmb debug on/off             - Enable/disable live BMB register debugging");
+        serialPort.println("  bmb dma on/off               - Single DMA frame vs word-by-word register reads");
+        serialPort.println("  bmb timing                   - Show per-register read time and Snap/current alignment");
+        serialPort.println("  bmb queue on/off             - Submit each BMB state as one SPI transaction queue");
+        serialPort.println("  bmb queue                    - Show ordering and timing of the last queued state");
+        serialPort.println("  bmb burst on/off             - Full pack scan per cycle vs staged low-power scan");
+        serialPort.println("  bmb sched                    - Show scan schedule and per-group update rates");
+        serialPort.println("  bmb pec [on/off/clear]       - Response PEC errors per chip/register, enable or reset");
+        serialPort.println("  bmb spi [cal|<hz>]           - Show BMB SPI clock, recalibrate, or set it");
         serialPort.println("  current diag                 - Run current sensor diagnostics");
         serialPort.println("  start as8510                 - Explicitly start AS8510 device");
+        serialPort.println("  as8510 sampler / sampler     - Show interrupt sampling rate, latency, losses and gain ranging");
         serialPort.println("  as8510 errors / errors       - Show AS8510 error codes");
+        serialPort.println("  soc [set <pct>]              - Coulomb counter status, or set SOC");
+        serialPort.println("  rint [reset]                 - Per-cell resistance estimates, or clear them");
         serialPort.println("  as8510 saturation / saturation - Show AS8510 saturation flags");
         serialPort.println("  as8510 diagnostics / diagnostics - Complete AS8510 diagnostics");
         serialPort.println("  param list                   - List all parameters");
@@ -267,7 +404,8 @@ void updateDisplay(uint8_t currentDutyCycle) {
     float avgVoltage = Param::GetFloat(Param::uavg) / 1000.0; // Convert mV to V
     
     // Get balancing information
-    BATMan::BalancingInfo balanceInfo = batman.getBalancingInfo();
+    BATMan::BalanceMap balanceMap;
+    batman.getBalanceMap(balanceMap);
 
     // All TFT display code commented out to avoid SPI conflicts
     /*
@@ -337,29 +475,27 @@ void updateDisplay(uint8_t currentDutyCycle) {
     // Display compact balancing information
     tft.setCursor(10, 170);
     tft.print("Balancing: ");
-    if (balanceInfo.balancingCells > 0) {
+    if (balanceMap.balancingCells > 0) {
         tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-        tft.print(balanceInfo.balancingCells);
+        tft.print(balanceMap.balancingCells);
         tft.print(" cells");
         
         // Show first few balancing cell numbers in compact format
-        if (balanceInfo.balancingCells <= 8) {
-            tft.print(" (");
-            for (int i = 0; i < balanceInfo.balancingCells; i++) {
-                if (i > 0) tft.print(",");
-                tft.print(balanceInfo.balancingCellNumbers[i]);
-            }
-            tft.print(")");
-        } else {
-            tft.print(" (");
-            for (int i = 0; i < 6; i++) {
+        BATMan::BalanceMap::Cursor cursor;
+        int lastCell = 0;
+        tft.print(" (");
+        for (int i = 0, cell = balanceMap.next(cursor); cell != 0; i++, cell = balanceMap.next(cursor)) {
+            if (i < 6 || balanceMap.balancingCells <= 8) {
                 if (i > 0) tft.print(",");
-                tft.print(balanceInfo.balancingCellNumbers[i]);
+                tft.print(cell);
             }
+            lastCell = cell;
+        }
+        if (balanceMap.balancingCells > 8) {
             tft.print("...");
-            tft.print(balanceInfo.balancingCellNumbers[balanceInfo.balancingCells-1]);
-            tft.print(")");
+            tft.print(lastCell);
         }
+        tft.print(")");
     } else {
         tft.setTextColor(TFT_GREEN, TFT_BLACK);
         tft.print("None");
@@ -377,7 +513,18 @@ void updateDisplay(uint8_t currentDutyCycle) {
 }
 
 // Function to update parameters from BATMan system data
+// BalanceCellList text, produced on "param get BalanceCellList" instead of every loop
+static size_t renderBalanceCellList(char* buf, size_t len) {
+    BATMan::BalanceMap balanceMap;
+    batman.getBalanceMap(balanceMap);
+    return balanceMap.formatList(buf, len);
+}
+
 void updateParametersFromBATMan() {
+    // Cells, stats and balance state go out as one batch so readers never see half an update.
+    // This is their only writer: the acquisition task hands them over in the published snapshot.
+    Param::BeginBatch();
+
     // Update cell voltages (u1-u108)
     for (int i = 0; i < 8; i++) {
         for (int j = 0; j < 15; j++) {
@@ -390,6 +537,13 @@ void updateParametersFromBATMan() {
         }
     }
     
+    // Cells per chip and in total, from the last measurement-phase scan
+    const PackStats &stats = batman.getPackStats();
+    for (int chip = 0; chip < 8; chip++) {
+        Param::SetInt(static_cast<Param::PARAM_NUM>(Param::Chip1Cells + chip), __builtin_popcount(stats.present[chip]));
+    }
+    Param::SetInt(Param::CellsPresent, stats.count);
+
     // Update voltage statistics
     Param::SetInt(Param::CellMax, batman.getMaxCell());
     Param::SetInt(Param::CellMin, batman.getMinCell());
@@ -397,24 +551,27 @@ void updateParametersFromBATMan() {
     Param::SetInt(Param::umin, batman.getMinVoltage());
     Param::SetInt(Param::deltaV, batman.getMaxVoltage() - batman.getMinVoltage());
     
-    // Update balance status and balancing cell list
-    Param::SetInt(Param::balance, balanceEnabled ? 1 : 0);
+    // Update balance status and balancing cell list. The balance parameter is the master copy
+    // (persisted, and settable with "param set balance"); balanceEnabled follows it.
+    balanceEnabled = Param::GetInt(Param::balance) != 0;
     Param::SetInt(Param::CellVmax, batman.getMaxVoltage());
     Param::SetInt(Param::CellVmin, batman.getMinVoltage());
     
-    // Get balancing information and create comma-separated list
-    BATMan::BalancingInfo balanceInfo = batman.getBalancingInfo();
-    Param::SetInt(Param::CellsBalancing, balanceInfo.balancingCells);
-    
-    // Create comma-separated string of balancing cell numbers
-    String balanceCellList = "";
-    for (int i = 0; i < balanceInfo.balancingCells; i++) {
-        if (i > 0) {
-            balanceCellList += ",";
-        }
-        balanceCellList += String(balanceInfo.balancingCellNumbers[i]);
+    // Balancing state as a bitmap; BalanceCellList is rendered from it only when read
+    BATMan::BalanceMap balanceMap;
+    batman.getBalanceMap(balanceMap);
+    Param::SetInt(Param::CellsBalancing, balanceMap.balancingCells);
+    char balanceHex[BMB_BALANCE_HEX_LEN];
+    balanceMap.formatHex(balanceHex, sizeof(balanceHex));
+    Param::SetString(Param::BalanceMap, balanceHex);
+
+    // Current at the instant the cell voltages above were frozen
+    const SyncedMeasurement &sync = batman.getSyncedMeasurement();
+    if (sync.valid) {
+        Param::SetFloat(Param::syncCurrent, sync.current);
+        Param::SetInt(Param::syncErrUs, sync.alignErrUs);
     }
-    Param::SetString(Param::BalanceCellList, balanceCellList);
+    Param::EndBatch();
     
     // Update temperature data (if available)
     // Note: This would need to be implemented based on actual temperature data from BATMan
@@ -427,6 +584,7 @@ void updateParametersFromBATMan() {
     
     // Update AS8510 temperature every time parameters are updated
     if (currentSensor.isInitialized()) {
+        CurrentSampler::SensorLock lock(currentSampler);
         float internalTemp = currentSensor.getInternalTemperature();
         Param::SetFloat(Param::as8510_temp, internalTemp);
     } else {
@@ -446,6 +604,7 @@ void runDiagnosticStep() {
     unsigned long currentTime = millis();
     if (currentTime - diagnosticStepTime < DIAGNOSTIC_STEP_INTERVAL) return;
     
+    CurrentSampler::SensorLock lock(currentSampler);
     switch (diagnosticStep) {
         case 0:
             diagnosticSerial->println("\n=== AS8510 Current Sensor Diagnostics (Rust-based) ===");
@@ -535,6 +694,7 @@ void startAS8510NonBlocking(HardwareSerial& serialPort) {
     static bool startInProgress = false;
     static unsigned long startTime = 0;
     static int startStep = 0;
+    CurrentSampler::SensorLock lock(currentSampler);
     
     if (!startInProgress) {
         serialPort.println("Explicitly starting AS8510 device...");
@@ -603,11 +763,27 @@ void setup() {
     Serial.println("  - AS8510: 1MHz on VSPI/SPI3_HOST (pins 32,25,33,26) - DEDICATED BUS");
     Serial.println("LCD disabled - BMB on HSPI, AS8510 on VSPI for clean separation");
     
+    // Restore persisted configuration (numbmbs, balance, BalHys, scan schedule) before the BMBs start
+    nvsParams.begin(PARAM_STORE_NAMESPACE);
+    ParamStore::begin(nvsParams);
+    balanceEnabled = Param::GetInt(Param::balance) != 0;
+
+    // Charge accounting carries on from the last checkpoint
+    coulombCounter.configure(Param::GetFloat(Param::capacity), Param::GetInt(Param::CurInvert) != 0);
+    if (!coulombCounter.begin()) {
+        Serial.printf("No charge checkpoint - SOC starts at %.0f%%, use 'soc set <pct>'\n", CC_DEFAULT_SOC);
+    }
+
     // Initialize the BATMan interface first
     batman.BatStart();
+    Param::SetRenderer(Param::BalanceCellList, renderBalanceCellList);
     
     // Allow BMB to settle before initializing AS8510
     delay(1000);
+
+#if BMB_ACQUISITION_TASK
+    batman.startTask();
+#endif
     
     // Initialize current sensor with new Rust-based library AFTER BMB
     Serial.println("Initializing AS8510 current sensor with Rust-based library...");
@@ -619,6 +795,11 @@ void setup() {
     
     // Set verbose logging to false to disable detailed debug output
     currentSensor.setVerboseLogging(false);
+
+    // From here on the data-ready interrupt paces current acquisition
+    if (currentSensor.isInitialized() && currentSampler.begin(AS8510_INT_PIN)) {
+        batman.setCurrentSource(currentAtSnap);
+    }
     
     Serial.println("System ready. Commands available on both Serial and Serial2 (pins 12/13)");
     Serial.println("LCD + AS8510 share VSPI bus - BMB on HSPI - All systems enabled - No rewiring needed");
@@ -633,6 +814,9 @@ void loop() {
     if (currentMillis - lastMainLoopTime < MAIN_LOOP_INTERVAL) {
         // Process serial commands even during throttled periods
         processSerialInputs();
+
+        // Advance BMB steps whose inter-frame gap timer has expired
+        batman.service();
         
         // Run non-blocking diagnostic steps if in progress
         runDiagnosticStep();
@@ -642,10 +826,41 @@ void loop() {
     lastMainLoopTime = currentMillis;
     
     // Run the BATMan state machine - TESTING: Re-enabled to check if this causes hang
-    batman.loop();
+    if (!batman.taskRunning()) {
+        batman.loop();
+    }
+
+    // Take the latest complete pack snapshot for everything below (never blocks)
+    batman.refreshView();
+
+    // Current samples queued by the AS8510 sampler since the last tick, into the coulomb counter
+    coulombCounter.configure(Param::GetFloat(Param::capacity), Param::GetInt(Param::CurInvert) != 0);
+    currentSampler.setAutoRange(Param::GetInt(Param::CurAutoRange) != 0);
+    drainCurrentSamples();
     
     // Update parameters from BATMan system data - ENABLED for ESPHome interface
     updateParametersFromBATMan();
+
+    coulombCounter.publish();
+    coulombCounter.loop(currentMillis);
+
+    // Each new snapshot pairs cell voltages with the current at their Snap: one resistance step.
+    // Only measurement-phase snapshots with cells read this cycle; balance current would show up
+    // as a drop across the cell and repeated readings carry no new step.
+    static uint32_t lastRintCycle = 0;
+    if (batman.getSnapshotCycle() != lastRintCycle) {
+        lastRintCycle = batman.getSnapshotCycle();
+        if (batman.getSnapshotBalancePhase() == 0 && batman.getSnapshotCellsFresh()) {
+            uint16_t cellMv[RINT_CELLS];
+            uint8_t cells = batman.getCellVoltages(cellMv, RINT_CELLS);
+            cellResistance.configure(Param::GetInt(Param::CurInvert) != 0);
+            cellResistance.update(cellMv, cells, batman.getSyncedMeasurement(), batman.getSnapshotTime());
+            cellResistance.publish();
+        }
+    }
+
+    // Commit changed configuration to NVS once it has been quiet for a while
+    ParamStore::loop(currentMillis);
     
     // Debug: Show we're alive every 10 seconds with voltage status
     static unsigned long lastHeartbeat = 0;
@@ -720,8 +935,14 @@ void loop() {
         lastCurrentRead = currentMillis;
         
         if (currentSensor.isInitialized()) {
+            CurrentSampler::SensorLock lock(currentSampler);
             // Get current measurement and update global variable for LCD display
-            currentReading = currentSensor.getCurrent();
+            // (the sampler task keeps it up to date when running)
+            if (!currentSampler.running()) {
+                currentReading = currentSensor.getCurrent();
+                CurrentSample polledSample = {(uint32_t)esp_timer_get_time(), currentReading, currentSampler.gain()};
+                coulombCounter.addSamples(&polledSample, 1, Param::GetFloat(Param::udc));
+            }
             
             // Get internal temperature measurement
             float internalTemp = currentSensor.getInternalTemperature();
@@ -732,6 +953,11 @@ void loop() {
             // Display current, temperature, and average cell voltage on one line
             Serial.printf("AS8510: %.3fA    %.1f°C    Avg Cell: %.3fV\n", 
                          currentReading, internalTemp, avgVoltage);
+            if (currentSampler.running()) {
+                Serial.printf("AS8510: peak %.3fA over %lu samples\n", currentPeak, (unsigned long)currentWindowSamples);
+            }
+            currentPeak = 0;
+            currentWindowSamples = 0;
             
         } else {
             Serial.println("AS8510 not initialized - attempting restart...");
@@ -812,6 +1038,30 @@ void loop() {
     runDiagnosticStep();
 }
 
+// Take everything the AS8510 sampler has queued: the newest sample becomes currentReading,
+// and the 2 s report shows the largest transient in between
+void drainCurrentSamples() {
+    CurrentSample batch[32];
+    uint32_t n;
+    while ((n = currentSampler.drain(batch, 32)) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            float magnitude = fabsf(batch[i].current);
+            if (magnitude > fabsf(currentPeak)) {
+                currentPeak = batch[i].current;
+            }
+        }
+        coulombCounter.addSamples(batch, n, Param::GetFloat(Param::udc));
+        currentWindowSamples += n;
+        currentReading = batch[n - 1].current;
+    }
+    Param::SetInt(Param::CurGain, currentSampler.gain());
+}
+
+// BATMan pairs each cell snapshot with the current at its Snap instant through this
+bool currentAtSnap(uint32_t timeUs, float &amps, uint32_t &errUs) {
+    return currentSampler.currentAt(timeUs, amps, errUs);
+}
+
 // Separate function to process serial inputs (can be called more frequently)
 void processSerialInputs() {
     // Process serial commands
@@ -0,0 +1,86 @@
+#include <unity.h>
+#include <string.h>
+#include "PackData.h"
+
+static uint8_t frame[72];
+static uint16_t volts[8][15];
+
+void setUp(void) {
+    memset(frame, 0, sizeof(frame));
+    memset(volts, 0, sizeof(volts));
+}
+
+void tearDown(void) {}
+
+// Little-endian cell word g of chip h, as the BMB sends cell registers
+static void putWord(int h, int g, uint16_t raw) {
+    frame[h * 9 + 2 * g] = raw & 0xFF;
+    frame[h * 9 + 2 * g + 1] = raw >> 8;
+}
+
+static void test_scale_matches_float_division(void) {
+    const BmbRegLayout &layout = PackData::cellRegLayout[0];
+    for (uint32_t raw = 0; raw < 0xFFFF; raw += 7) {
+        putWord(0, 0, (uint16_t)raw);
+        PackData::decodeCellFrame(frame, layout, 0x01, 1, volts);
+        TEST_ASSERT_EQUAL_UINT16((uint16_t)(raw / 12.5), volts[0][0]);
+    }
+}
+
+static void test_registers_land_in_their_columns(void) {
+    for (int r = 0; r < 5; r++) {
+        memset(volts, 0, sizeof(volts));
+        for (int h = 0; h < 8; h++)
+            for (int g = 0; g < 3; g++)
+                putWord(h, g, (uint16_t)(25 * (100 * h + 10 * r + g)));
+        PackData::decodeCellFrame(frame, PackData::cellRegLayout[r], 0xFF, 8, volts);
+        TEST_ASSERT_EQUAL_UINT8(0x47 + r, PackData::cellRegLayout[r].reqID);
+        for (int h = 0; h < 8; h++) {
+            for (int reg = 0; reg < 15; reg++) {
+                bool mine = reg >= 3 * r && reg < 3 * r + 3;
+                uint16_t expect = mine ? (uint16_t)(2 * (100 * h + 10 * r + reg - 3 * r)) : 0;
+                TEST_ASSERT_EQUAL_UINT16(expect, volts[h][reg]);
+            }
+        }
+    }
+}
+
+static void test_invalid_word_keeps_previous(void) {
+    volts[2][4] = 3700;
+    putWord(2, 1, 0xFFFF);
+    putWord(2, 0, 46250);
+    PackData::decodeCellFrame(frame, PackData::cellRegLayout[1], 0xFF, 8, volts);
+    TEST_ASSERT_EQUAL_UINT16(3700, volts[2][3]);
+    TEST_ASSERT_EQUAL_UINT16(3700, volts[2][4]);
+}
+
+static void test_pec_failed_chips_are_skipped(void) {
+    for (int h = 0; h < 8; h++) {
+        volts[h][0] = 1111;
+        putWord(h, 0, 50000);
+    }
+    PackData::decodeCellFrame(frame, PackData::cellRegLayout[0], 0x55, 8, volts);
+    for (int h = 0; h < 8; h++) {
+        TEST_ASSERT_EQUAL_UINT16((h & 1) ? 1111 : 4000, volts[h][0]);
+    }
+}
+
+static void test_only_configured_chips_are_written(void) {
+    for (int h = 0; h < 8; h++) putWord(h, 0, 50000);
+    PackData::decodeCellFrame(frame, PackData::cellRegLayout[0], 0xFF, 3, volts);
+    TEST_ASSERT_EQUAL_UINT16(4000, volts[2][0]);
+    TEST_ASSERT_EQUAL_UINT16(0, volts[3][0]);
+    // More than 8 chips is clamped rather than read past the frame
+    PackData::decodeCellFrame(frame, PackData::cellRegLayout[0], 0xFFFF, 12, volts);
+    TEST_ASSERT_EQUAL_UINT16(4000, volts[7][0]);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_scale_matches_float_division);
+    RUN_TEST(test_registers_land_in_their_columns);
+    RUN_TEST(test_invalid_word_keeps_previous);
+    RUN_TEST(test_pec_failed_chips_are_skipped);
+    RUN_TEST(test_only_configured_chips_are_written);
+    return UNITY_END();
+}
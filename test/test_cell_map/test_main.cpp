@@ -0,0 +1,100 @@
+#include <unity.h>
+#include <string.h>
+#include "PackData.h"
+
+static CellMap map;
+
+void setUp(void) {
+    map.clear();
+}
+
+void tearDown(void) {}
+
+// The old lookup: count present slots in chip, register order up to (chip, reg)
+static int scanCellNumber(const uint16_t present[8], int chip, int reg) {
+    int cell = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 15; j++) {
+            if (present[i] & (1 << j)) {
+                cell++;
+                if (i == chip && j == reg) return cell;
+            }
+        }
+    }
+    return 0;
+}
+
+static void checkAgainstScan(const uint16_t present[8]) {
+    int cells = 0;
+    for (int chip = 0; chip < 8; chip++) {
+        for (int reg = 0; reg < 15; reg++) {
+            int cell = scanCellNumber(present, chip, reg);
+            TEST_ASSERT_EQUAL_UINT8(cell, map.cellOfSlot[chip][reg]);
+            if (cell) {
+                cells++;
+                TEST_ASSERT_EQUAL_UINT8((chip << 4) | reg, map.slotOfCell[cell]);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT8(cells, map.cells);
+}
+
+static void test_empty_pack_has_no_cells(void) {
+    uint16_t present[8] = {0};
+    TEST_ASSERT_FALSE(map.update(present));
+    TEST_ASSERT_EQUAL_UINT8(0, map.cells);
+    TEST_ASSERT_EQUAL_UINT8(0, map.cellOfSlot[0][0]);
+}
+
+static void test_full_tesla_pack(void) {
+    // 4 BMBs x 2 chips, 13 or 14 cells each: 108 cells
+    uint16_t present[8];
+    for (int chip = 0; chip < 8; chip++) present[chip] = (chip & 1) ? 0x1FFF : 0x3FFF;
+    TEST_ASSERT_TRUE(map.update(present));
+    TEST_ASSERT_EQUAL_UINT8(108, map.cells);
+    TEST_ASSERT_EQUAL_UINT8(1, map.cellOfSlot[0][0]);
+    TEST_ASSERT_EQUAL_UINT8(15, map.cellOfSlot[1][0]);
+    TEST_ASSERT_EQUAL_UINT8(108, map.cellOfSlot[7][12]);
+    TEST_ASSERT_EQUAL_UINT8(0, map.cellOfSlot[7][13]);
+    checkAgainstScan(present);
+}
+
+static void test_gaps_match_sequential_scan(void) {
+    uint32_t seed = 0x12345678;
+    for (int round = 0; round < 200; round++) {
+        uint16_t present[8];
+        for (int chip = 0; chip < 8; chip++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            present[chip] = seed & 0x7FFF;
+        }
+        map.update(present);
+        checkAgainstScan(present);
+    }
+}
+
+static void test_rebuilds_only_on_topology_change(void) {
+    uint16_t present[8] = {0x7, 0, 0, 0, 0, 0, 0, 0};
+    TEST_ASSERT_TRUE(map.update(present));
+    TEST_ASSERT_FALSE(map.update(present));
+    TEST_ASSERT_EQUAL_UINT32(1, map.rebuilds);
+
+    // A cell dropping out renumbers everything after it and clears the stale reverse entry
+    present[0] = 0x5;
+    TEST_ASSERT_TRUE(map.update(present));
+    TEST_ASSERT_EQUAL_UINT32(2, map.rebuilds);
+    TEST_ASSERT_EQUAL_UINT8(2, map.cells);
+    TEST_ASSERT_EQUAL_UINT8(0, map.cellOfSlot[0][1]);
+    TEST_ASSERT_EQUAL_UINT8(2, map.cellOfSlot[0][2]);
+    TEST_ASSERT_EQUAL_UINT8(0, map.slotOfCell[3]);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_pack_has_no_cells);
+    RUN_TEST(test_full_tesla_pack);
+    RUN_TEST(test_gaps_match_sequential_scan);
+    RUN_TEST(test_rebuilds_only_on_topology_change);
+    return UNITY_END();
+}
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <math.h>
+#include "CellResistance.h"
+#include "Param.h"
+
+#define CELLS    96
+#define BAD_CELL 37     // One cell well above the rest
+
+static CellResistance est;
+static float trueR[CELLS];
+static float ocv[CELLS];
+static uint16_t mv[CELLS];
+static uint32_t seed;
+
+// Fixed seed so a failure repeats
+static float rnd(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) / 16777216.0f;
+}
+
+void setUp(void) {
+    seed = 0x2545F491;
+    est = CellResistance();
+    for (int i = 0; i < CELLS; i++) {
+        trueR[i] = i + 1 == BAD_CELL ? 3.0f : 0.5f + rnd();
+        ocv[i] = 3600.0f + 100.0f * rnd();
+    }
+}
+
+void tearDown(void) {}
+
+// Synthetic pack with known resistances: the current holds most of the time, otherwise jumps
+// anywhere in +/-150 A; every 7th snapshot has no current near its Snap
+static void runPack(uint32_t snapshots) {
+    SyncedMeasurement sync = {0, 0, 0, true};
+    float current = 0;
+    for (uint32_t k = 0; k < snapshots; k++) {
+        if (rnd() < 0.3f) {
+            current = 300.0f * rnd() - 150.0f;
+        }
+        for (int i = 0; i < CELLS; i++) {
+            // OCV follows the charge; the ADC quantises to 1 mV with +/-1 mV of noise
+            ocv[i] += current * 0.0002f;
+            mv[i] = (uint16_t)lroundf(ocv[i] + trueR[i] * current + 2.0f * rnd() - 1.0f);
+        }
+        sync.current = current;
+        sync.alignErrUs = (k % 7 == 0) ? RINT_MAX_ALIGN_US + 1 : 400;
+        est.update(mv, CELLS, sync, k * 100);
+    }
+}
+
+static void test_estimates_converge(void) {
+    runPack(2000);
+    TEST_ASSERT_GREATER_THAN(100, est.stepsApplied());
+    TEST_ASSERT_GREATER_THAN(0, est.misalignedCount());
+    for (int i = 0; i < CELLS; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, trueR[i], est.resistance(i + 1));
+    }
+}
+
+static void test_high_resistance_cell_published(void) {
+    runPack(2000);
+    est.publish();
+    TEST_ASSERT_EQUAL_INT(BAD_CELL, Param::GetInt(Param::RmaxCell));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 3.0f, Param::GetFloat(Param::Rmax));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, trueR[0], Param::GetFloat(Param::r1));
+    // Beyond the pack the rows read zero
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, Param::GetFloat(Param::r108));
+}
+
+static void test_no_estimate_before_min_updates(void) {
+    SyncedMeasurement sync = {0, 0, 400, true};
+    for (int i = 0; i < CELLS; i++) mv[i] = 3600;
+    est.update(mv, CELLS, sync, 0);
+    sync.current = 50.0f;
+    for (int i = 0; i < CELLS; i++) mv[i] = 3625;
+    est.update(mv, CELLS, sync, 100);
+    TEST_ASSERT_EQUAL_UINT32(1, est.stepsApplied());
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, est.resistance(1));
+}
+
+static void test_small_and_stale_steps_skipped(void) {
+    SyncedMeasurement sync = {0, 0, 400, true};
+    for (int i = 0; i < CELLS; i++) mv[i] = 3600;
+    est.update(mv, CELLS, sync, 0);
+    sync.current = RINT_MIN_STEP_A / 2;
+    est.update(mv, CELLS, sync, 100);
+    TEST_ASSERT_EQUAL_UINT32(0, est.stepsApplied());
+    // A step after the reference has aged out becomes the new reference instead
+    sync.current = 2 * RINT_MIN_STEP_A;
+    est.update(mv, CELLS, sync, 100 + RINT_MAX_GAP_MS + 1);
+    TEST_ASSERT_EQUAL_UINT32(0, est.stepsApplied());
+    TEST_ASSERT_EQUAL_UINT32(1, est.staleCount());
+}
+
+static void test_cell_count_change_resets(void) {
+    runPack(2000);
+    TEST_ASSERT_TRUE(est.resistance(1) > 0);
+    // A cell dropping out invalidates the numbering
+    SyncedMeasurement sync = {0, 0, 400, true};
+    est.update(mv, CELLS - 1, sync, 200100);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, est.resistance(1));
+}
+
+static void test_sign_change_resets(void) {
+    runPack(2000);
+    est.configure(true);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, est.resistance(1));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_estimates_converge);
+    RUN_TEST(test_high_resistance_cell_published);
+    RUN_TEST(test_no_estimate_before_min_updates);
+    RUN_TEST(test_small_and_stale_steps_skipped);
+    RUN_TEST(test_cell_count_change_resets);
+    RUN_TEST(test_sign_change_resets);
+    return UNITY_END();
+}
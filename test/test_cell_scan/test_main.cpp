@@ -0,0 +1,107 @@
+#include <unity.h>
+#include <string.h>
+#include "CellScan.h"
+
+#define MAX_CELLS 1024
+
+static uint32_t cells[(MAX_CELLS + 2) / 2];   // word storage so both alignments can be tested
+static uint32_t maskA[(MAX_CELLS + 32) / 32];
+static uint32_t maskB[(MAX_CELLS + 32) / 32];
+static uint16_t *const base = (uint16_t *)cells;
+
+// Repeatable pseudo-random cell codes: mostly 3.0-4.2 V, some empty slots, the odd outlier
+static uint32_t seed;
+static uint32_t nextRand() {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static void fill(uint16_t *v, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = nextRand();
+        switch (r & 15) {
+            case 0:  v[i] = r >> 28; break;                         // empty slot, 0-15
+            case 1:  v[i] = (r >> 16) % (CELL_SCAN_MAX_CODE + 1); break;
+            default: v[i] = 3000 + (r >> 16) % 1200; break;
+        }
+    }
+}
+
+static void checkSame(const uint16_t *v, size_t n, uint16_t threshold) {
+    CellScanResult a, b;
+    memset(maskA, 0xAA, sizeof(maskA));
+    memset(maskB, 0x55, sizeof(maskB));
+    CellScan::scalar(v, n, threshold, a, maskA);
+    CellScan::swar(v, n, threshold, b, maskB);
+    TEST_ASSERT_EQUAL_UINT32(a.sum, b.sum);
+    TEST_ASSERT_EQUAL_UINT16(a.min, b.min);
+    TEST_ASSERT_EQUAL_UINT16(a.max, b.max);
+    TEST_ASSERT_EQUAL_UINT16(a.count, b.count);
+    TEST_ASSERT_EQUAL_UINT16(a.above, b.above);
+    TEST_ASSERT_EQUAL_MEMORY(maskA, maskB, ((n + 31) / 32) * sizeof(uint32_t));
+}
+
+void setUp(void) {
+    seed = 0x2545F491u;
+}
+
+void tearDown(void) {}
+
+static void test_scalar_reference(void) {
+    const uint16_t v[] = {0, 3600, 10, 11, 4200, 3700, 3600};
+    CellScanResult r;
+    uint32_t mask[1];
+    CellScan::scalar(v, 7, 3600, r, mask);
+    TEST_ASSERT_EQUAL_UINT16(5, r.count);
+    TEST_ASSERT_EQUAL_UINT32(3600 + 11 + 4200 + 3700 + 3600, r.sum);
+    TEST_ASSERT_EQUAL_UINT16(11, r.min);
+    TEST_ASSERT_EQUAL_UINT16(4200, r.max);
+    TEST_ASSERT_EQUAL_UINT16(2, r.above);
+    TEST_ASSERT_EQUAL_UINT32((1u << 4) | (1u << 5), mask[0]);
+}
+
+static void test_no_cells(void) {
+    memset(base, 0, 64 * sizeof(uint16_t));
+    CellScanResult r;
+    CellScan::swar(base, 64, 0, r, NULL);
+    TEST_ASSERT_EQUAL_UINT16(0, r.count);
+    TEST_ASSERT_EQUAL_UINT16(0, r.min);
+    TEST_ASSERT_EQUAL_UINT16(0, r.max);
+    checkSame(base, 64, 0);
+    checkSame(base, 0, 0);
+}
+
+static void test_swar_matches_scalar_random(void) {
+    for (int t = 0; t < 400; t++) {
+        size_t len = nextRand() % (MAX_CELLS + 1);
+        uint16_t *v = base + (t & 1);
+        uint16_t threshold = (t % 10 == 0) ? 0xFFFF : (uint16_t)(nextRand() % 4500);
+        fill(v, len);
+        checkSame(v, len, threshold);
+    }
+}
+
+// Lane edges: the largest code, codes either side of the absent rule, an odd length with the
+// first cell peeled, and a threshold right at a cell
+static void test_swar_lane_edges(void) {
+    const uint16_t edge[] = {CELL_SCAN_MAX_CODE, 10, 11, CELL_SCAN_MAX_CODE - 1, 3600, 3601, 0, 1};
+    for (size_t off = 0; off < 2; off++) {
+        memcpy(base + off, edge, sizeof(edge));
+        for (size_t n = 1; n <= 8; n++) {
+            checkSame(base + off, n, 3600);
+            checkSame(base + off, n, CELL_SCAN_MAX_CODE);
+            checkSame(base + off, n, 0);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_scalar_reference);
+    RUN_TEST(test_no_cells);
+    RUN_TEST(test_swar_matches_scalar_random);
+    RUN_TEST(test_swar_lane_edges);
+    return UNITY_END();
+}
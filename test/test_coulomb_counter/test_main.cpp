@@ -0,0 +1,133 @@
+#include <unity.h>
+#include <math.h>
+#include "CoulombCounter.h"
+#include "ParamStore.h"
+
+static MemoryParamBackend mem;
+
+void setUp(void) {
+    mem.erase();
+    ParamStore::begin(mem);
+}
+
+void tearDown(void) {}
+
+// Feed n samples of profile(k) at stepUs +/- jitter, in batches as the main loop would
+template <typename Profile>
+static void replay(CoulombCounter &cc, uint32_t startUs, uint32_t n, uint32_t stepUs, uint32_t jitterUs,
+                   float packV, Profile profile) {
+    CurrentSample batch[32];
+    uint32_t t = startUs;
+    uint32_t k = 0;
+    while (k < n) {
+        uint32_t m = 0;
+        for (; m < 32 && k < n; m++, k++) {
+            // Alternate early/late so the average step stays exact
+            t += stepUs + ((k & 1) ? jitterUs : (uint32_t)-jitterUs);
+            batch[m].timeUs = t;
+            batch[m].current = profile(k);
+            batch[m].gain = 0;
+        }
+        cc.addSamples(batch, m, packV);
+    }
+}
+
+// 10 A for 10 minutes at 1 kHz: exactly 10/6 Ah, where a float Ah sum has already drifted
+static void test_constant_current_is_exact(void) {
+    CoulombCounter cc;
+    cc.configure(100, false);
+    cc.setSoc(0);
+    replay(cc, 0, 600001, 1000, 0, 0, [](uint32_t) { return 10.0f; });    // First sample starts the clock
+    TEST_ASSERT_TRUE(cc.chargeInMaus() == 10000LL * 600000000LL);
+    TEST_ASSERT_TRUE(cc.chargeOutMaus() == 0);
+    TEST_ASSERT_TRUE(cc.remainingMaus() == cc.chargeInMaus());
+}
+
+// +/-50 A square wave with timing jitter across the 2^32 us wrap: nets to zero
+static void test_square_wave_nets_to_zero(void) {
+    CoulombCounter cc;
+    cc.configure(100, false);
+    cc.setSoc(50);
+    int64_t before = cc.remainingMaus();
+    replay(cc, 0xFFFF0000u, 200001, 1000, 7, 400,
+           [](uint32_t k) { return ((k - 1) / 50) & 1 ? -50.0f : 50.0f; });
+    TEST_ASSERT_TRUE(cc.chargeInMaus() == cc.chargeOutMaus());
+    TEST_ASSERT_TRUE(cc.remainingMaus() == before);
+    TEST_ASSERT_TRUE(cc.energyInWh() == cc.energyOutWh());
+}
+
+// 100 A out at 400 V for 36 s: exactly 1 Ah and 400 Wh, inverted sign convention
+static void test_inverted_discharge(void) {
+    CoulombCounter cc;
+    cc.configure(100, true);
+    cc.setSoc(100);
+    replay(cc, 12345, 36001, 1000, 0, 400, [](uint32_t) { return 100.0f; });
+    TEST_ASSERT_TRUE(cc.chargeOutMaus() == CC_MAUS_PER_AH);
+    TEST_ASSERT_TRUE(cc.chargeInMaus() == 0);
+    TEST_ASSERT_TRUE(cc.energyOutWh() == 400.0);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 99.0f, cc.soc());
+}
+
+// A stalled sampler counts as CC_MAX_GAP_US, and remaining stops at capacity
+static void test_gap_limit_and_clamp(void) {
+    CoulombCounter cc;
+    cc.configure(1, false);
+    cc.setSoc(99);
+    CurrentSample s[2] = {{0, 0, 0}, {5000000, 1000.0f, 0}};
+    cc.addSamples(s, 2, 0);
+    TEST_ASSERT_TRUE(cc.chargeInMaus() == 1000000LL * CC_MAX_GAP_US);
+    TEST_ASSERT_TRUE(cc.remainingMaus() == cc.capacityMaus());
+}
+
+static void test_checkpoint_round_trip(void) {
+    CoulombCounter cc;
+    cc.configure(100, false);
+    TEST_ASSERT_FALSE(cc.begin());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, CC_DEFAULT_SOC, cc.soc());
+    cc.setSoc(20);
+    replay(cc, 0, 3601, 1000, 0, 50, [](uint32_t) { return 20.0f; });
+    TEST_ASSERT_TRUE(cc.checkpoint(1000));
+
+    CoulombCounter restored;
+    restored.configure(100, false);
+    TEST_ASSERT_TRUE(restored.begin());
+    TEST_ASSERT_TRUE(restored.remainingMaus() == cc.remainingMaus());
+    TEST_ASSERT_TRUE(restored.chargeInMaus() == cc.chargeInMaus());
+    TEST_ASSERT_TRUE(restored.energyInWh() == cc.energyInWh());
+}
+
+static void test_checkpoint_schedule(void) {
+    CoulombCounter cc;
+    cc.configure(100, false);
+    cc.begin();
+    uint32_t saves = mem.saves;
+
+    // A 1% move is saved, but not before CC_CHECKPOINT_MIN_MS
+    cc.setSoc(CC_DEFAULT_SOC + 2 * CC_CHECKPOINT_SOC_STEP);
+    cc.loop(CC_CHECKPOINT_MIN_MS - 1);
+    TEST_ASSERT_EQUAL_UINT32(saves, mem.saves);
+    cc.loop(CC_CHECKPOINT_MIN_MS);
+    TEST_ASSERT_EQUAL_UINT32(saves + 1, mem.saves);
+
+    // A small change waits for CC_CHECKPOINT_MAX_MS
+    replay(cc, 0, 11, 1000, 0, 0, [](uint32_t) { return 1.0f; });
+    cc.loop(CC_CHECKPOINT_MIN_MS + CC_CHECKPOINT_MAX_MS - 1);
+    TEST_ASSERT_EQUAL_UINT32(saves + 1, mem.saves);
+    cc.loop(CC_CHECKPOINT_MIN_MS + CC_CHECKPOINT_MAX_MS);
+    TEST_ASSERT_EQUAL_UINT32(saves + 2, mem.saves);
+
+    // Nothing changed: no more writes
+    cc.loop(CC_CHECKPOINT_MIN_MS + 3 * CC_CHECKPOINT_MAX_MS);
+    TEST_ASSERT_EQUAL_UINT32(saves + 2, mem.saves);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_constant_current_is_exact);
+    RUN_TEST(test_square_wave_nets_to_zero);
+    RUN_TEST(test_inverted_discharge);
+    RUN_TEST(test_gap_limit_and_clamp);
+    RUN_TEST(test_checkpoint_round_trip);
+    RUN_TEST(test_checkpoint_schedule);
+    return UNITY_END();
+}
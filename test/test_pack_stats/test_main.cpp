@@ -0,0 +1,106 @@
+#include <unity.h>
+#include <string.h>
+#include <math.h>
+#include "PackData.h"
+
+static uint16_t volts[8][15];
+static PackStats stats;
+
+void setUp(void) {
+    memset(volts, 0, sizeof(volts));
+}
+
+void tearDown(void) {}
+
+static void test_empty_pack(void) {
+    PackData::packStats(volts, 8, 0xFFFF, stats);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.count);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.min);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.max);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.minCell);
+    TEST_ASSERT_EQUAL_UINT8(0, stats.maxCell);
+}
+
+static void test_absent_slots_are_skipped(void) {
+    volts[0][0] = 10;       // at the threshold: absent
+    volts[0][1] = 3600;
+    volts[1][3] = 3700;
+    PackData::packStats(volts, 8, 0xFFFF, stats);
+    TEST_ASSERT_EQUAL_UINT8(2, stats.count);
+    TEST_ASSERT_EQUAL_UINT32(7300, stats.sum);
+    TEST_ASSERT_EQUAL_HEX16(0x0002, stats.present[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x0008, stats.present[1]);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.minCell);
+    TEST_ASSERT_EQUAL_UINT8(2, stats.maxCell);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.maxChip);
+    TEST_ASSERT_EQUAL_UINT8(3, stats.maxReg);
+}
+
+static void test_first_cell_wins_ties(void) {
+    volts[0][2] = 3500;
+    volts[3][4] = 3500;
+    volts[1][0] = 3900;
+    volts[6][9] = 3900;
+    PackData::packStats(volts, 8, 0xFFFF, stats);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.minCell);
+    TEST_ASSERT_EQUAL_UINT8(2, stats.maxCell);
+}
+
+static void test_balance_bitmap_and_count(void) {
+    volts[0][0] = 3800;
+    volts[0][1] = 3801;
+    volts[2][14] = 4100;
+    PackData::packStats(volts, 8, 3800, stats);
+    TEST_ASSERT_EQUAL_UINT8(2, stats.balancing);
+    TEST_ASSERT_EQUAL_HEX16(0x0002, stats.balance[0]);
+    TEST_ASSERT_EQUAL_HEX16(0x4000, stats.balance[2]);
+}
+
+static void test_only_configured_chips_count(void) {
+    volts[0][0] = 3600;
+    volts[5][0] = 3600;
+    PackData::packStats(volts, 2, 0xFFFF, stats);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.count);
+    TEST_ASSERT_EQUAL_HEX16(0, stats.present[5]);
+}
+
+// Mean and population standard deviation against a double-precision reference on random packs
+static void test_mean_and_std_dev_match_reference(void) {
+    uint32_t seed = 0xC0FFEE;
+    for (int round = 0; round < 500; round++) {
+        double sum = 0, sumSq = 0;
+        int n = 0;
+        for (int chip = 0; chip < 8; chip++) {
+            for (int reg = 0; reg < 15; reg++) {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                volts[chip][reg] = (seed & 7) == 0 ? 0 : (uint16_t)(3000 + (seed >> 8) % 1200);
+                if (volts[chip][reg] > 10) {
+                    sum += volts[chip][reg];
+                    sumSq += (double)volts[chip][reg] * volts[chip][reg];
+                    n++;
+                }
+            }
+        }
+        PackData::packStats(volts, 8, 0xFFFF, stats);
+        double mean = sum / n;
+        double sd = sqrt(sumSq / n - mean * mean);
+        TEST_ASSERT_EQUAL_UINT8(n, stats.count);
+        TEST_ASSERT_EQUAL_UINT16((uint16_t)(mean + 0.5), stats.mean);
+        // Integer square root truncates
+        TEST_ASSERT_FLOAT_WITHIN(1.0, sd, stats.stdDev);
+        TEST_ASSERT_TRUE(stats.stdDev <= sd + 1e-6);
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_pack);
+    RUN_TEST(test_absent_slots_are_skipped);
+    RUN_TEST(test_first_cell_wins_ties);
+    RUN_TEST(test_balance_bitmap_and_count);
+    RUN_TEST(test_only_configured_chips_count);
+    RUN_TEST(test_mean_and_std_dev_match_reference);
+    return UNITY_END();
+}
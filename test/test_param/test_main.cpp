@@ -0,0 +1,107 @@
+#include <unity.h>
+#include <string.h>
+#include "Param.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_defaults_come_from_the_registry(void) {
+    TEST_ASSERT_EQUAL_INT(1, Param::GetInt(Param::numbmbs));
+    TEST_ASSERT_EQUAL_INT(0, Param::GetInt(Param::u108));
+    const Param::Info* info = Param::GetInfo(Param::u1);
+    TEST_ASSERT_NOT_NULL(info);
+    TEST_ASSERT_EQUAL_STRING("u1", info->name);
+    TEST_ASSERT_EQUAL_INT(Param::TYPE_INT, info->type);
+    TEST_ASSERT_EQUAL_INT32(5000, info->max);
+    TEST_ASSERT_EQUAL_STRING("mV", info->unit);
+}
+
+static void test_out_of_range_params_are_ignored(void) {
+    const Param::PARAM_NUM bad = static_cast<Param::PARAM_NUM>(Param::PARAM_COUNT);
+    TEST_ASSERT_NULL(Param::GetInfo(bad));
+    Param::SetInt(bad, 7);
+    TEST_ASSERT_EQUAL_INT(0, Param::GetInt(bad));
+    TEST_ASSERT_EQUAL_STRING("unknown", Param::GetParamName(bad));
+    float out[2];
+    TEST_ASSERT_EQUAL_UINT32(0, Param::ReadFloats(static_cast<Param::PARAM_NUM>(Param::PARAM_COUNT - 1), 2, out));
+}
+
+static void test_int_and_float_slots_convert(void) {
+    Param::SetInt(Param::u5, 3712);
+    TEST_ASSERT_EQUAL_INT(3712, Param::GetInt(Param::u5));
+    TEST_ASSERT_EQUAL_FLOAT(3712.0f, Param::GetFloat(Param::u5));
+
+    // Floats written to an INT slot round to nearest
+    Param::SetFloat(Param::u5, 3712.6f);
+    TEST_ASSERT_EQUAL_INT(3713, Param::GetInt(Param::u5));
+
+    Param::SetFloat(Param::udc, 401.75f);
+    TEST_ASSERT_EQUAL_FLOAT(401.75f, Param::GetFloat(Param::udc));
+    TEST_ASSERT_EQUAL_INT(401, Param::GetInt(Param::udc));
+    Param::SetInt(Param::udc, 399);
+    TEST_ASSERT_EQUAL_FLOAT(399.0f, Param::GetFloat(Param::udc));
+}
+
+static void test_read_floats_copies_a_block(void) {
+    for (int i = 0; i < 4; i++) {
+        Param::SetInt(static_cast<Param::PARAM_NUM>(Param::u1 + i), 3600 + i);
+    }
+    float v[4];
+    TEST_ASSERT_TRUE(Param::ReadFloats(Param::u1, 4, v) != 0);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(3600.0f + i, v[i]);
+    }
+
+    const Param::PARAM_NUM list[] = {Param::udc, Param::u2};
+    Param::SetFloat(Param::udc, 12.5f);
+    Param::ReadFloats(list, 2, v);
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, v[0]);
+    TEST_ASSERT_EQUAL_FLOAT(3601.0f, v[1]);
+}
+
+static void test_strings_are_stored_truncated(void) {
+    char buf[64];
+    Param::SetString(Param::BalanceMap, "1F");
+    TEST_ASSERT_EQUAL_UINT32(2, Param::GetString(Param::BalanceMap, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("1F", buf);
+
+    // Stored text is limited to the fixed slot; reads into a short buffer report the full length
+    Param::SetString(Param::BalanceMap, "0123456789abcdef0123456789abcdef0123");
+    TEST_ASSERT_EQUAL_UINT32(31, Param::GetString(Param::BalanceMap, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_UINT32(31, Param::GetString(Param::BalanceMap, buf, 4));
+    TEST_ASSERT_EQUAL_STRING("012", buf);
+
+    // Not a STRING parameter
+    TEST_ASSERT_EQUAL_UINT32(0, Param::GetString(Param::u1, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("", buf);
+}
+
+static size_t renderCells(char* buf, size_t len) {
+    return (size_t)snprintf(buf, len, "3,17,42");
+}
+
+static void test_renderer_produces_text_on_read(void) {
+    char buf[16];
+    Param::SetRenderer(Param::BalanceCellList, renderCells);
+    TEST_ASSERT_EQUAL_UINT32(7, Param::GetString(Param::BalanceCellList, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("3,17,42", buf);
+    Param::SetRenderer(Param::BalanceCellList, nullptr);
+}
+
+static void test_storage_is_static_and_flat(void) {
+    // One 32-bit value and one 32-bit reported copy per parameter, plus the change stamps
+    TEST_ASSERT_GREATER_OR_EQUAL(3 * 4 * Param::PARAM_COUNT, Param::StorageBytes());
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_defaults_come_from_the_registry);
+    RUN_TEST(test_out_of_range_params_are_ignored);
+    RUN_TEST(test_int_and_float_slots_convert);
+    RUN_TEST(test_read_floats_copies_a_block);
+    RUN_TEST(test_strings_are_stored_truncated);
+    RUN_TEST(test_renderer_produces_text_on_read);
+    RUN_TEST(test_storage_is_static_and_flat);
+    return UNITY_END();
+}
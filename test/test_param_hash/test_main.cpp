@@ -0,0 +1,78 @@
+#include <unity.h>
+#include <string.h>
+#include <ctype.h>
+#include "Param.h"
+
+static const Param::PARAM_NUM NONE = static_cast<Param::PARAM_NUM>(-1);
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_every_name_resolves_to_itself(void) {
+    for (int i = 0; i < Param::PARAM_COUNT; i++) {
+        const Param::PARAM_NUM p = static_cast<Param::PARAM_NUM>(i);
+        const char* name = Param::GetParamName(p);
+        TEST_ASSERT_EQUAL_INT(i, Param::GetParamFromName(name));
+        TEST_ASSERT_EQUAL_INT(i, Param::GetParamFromNameNoCase(name));
+    }
+}
+
+static void test_case_folding(void) {
+    char upper[40];
+    for (int i = 0; i < Param::PARAM_COUNT; i++) {
+        const char* name = Param::GetParamName(static_cast<Param::PARAM_NUM>(i));
+        size_t n = strlen(name);
+        TEST_ASSERT_LESS_THAN(sizeof(upper), n);
+        for (size_t k = 0; k <= n; k++) upper[k] = (char)toupper((unsigned char)name[k]);
+        TEST_ASSERT_EQUAL_INT(i, Param::GetParamFromNameNoCase(upper));
+        if (strcmp(upper, name) != 0) {
+            TEST_ASSERT_EQUAL_INT(NONE, Param::GetParamFromName(upper));
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(Param::as8510_temp, Param::GetParamFromNameNoCase("AS8510_Temp"));
+}
+
+// Names that hash into an occupied slot must still be rejected by the final compare
+static void test_unknown_names_are_rejected(void) {
+    static const char* const unknown[] = {
+        "", "u", "u0", "u109", "u1000", "U1x", "numbmb", "numbmbss", "as8510_tem", "as8510_temp ",
+        " numbmbs", "Chipt8", "zz_not_a_param", "balanc", "udcx",
+    };
+    for (const char* name : unknown) {
+        TEST_ASSERT_EQUAL_INT(NONE, Param::GetParamFromName(name));
+        TEST_ASSERT_EQUAL_INT(NONE, Param::GetParamFromNameNoCase(name));
+    }
+}
+
+// Lookups agree with a linear strcmp scan for every one-character change of every name
+static void test_matches_linear_scan_on_mutations(void) {
+    char buf[40];
+    for (int i = 0; i < Param::PARAM_COUNT; i++) {
+        const char* name = Param::GetParamName(static_cast<Param::PARAM_NUM>(i));
+        size_t n = strlen(name);
+        for (size_t pos = 0; pos < n; pos++) {
+            for (char c = '0'; c <= 'z'; c += 7) {
+                memcpy(buf, name, n + 1);
+                buf[pos] = c;
+                int expect = -1;
+                for (int j = 0; j < Param::PARAM_COUNT; j++) {
+                    if (strcmp(Param::GetParamName(static_cast<Param::PARAM_NUM>(j)), buf) == 0) {
+                        expect = j;
+                        break;
+                    }
+                }
+                TEST_ASSERT_EQUAL_INT(expect, (int)Param::GetParamFromName(buf));
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_every_name_resolves_to_itself);
+    RUN_TEST(test_case_folding);
+    RUN_TEST(test_unknown_names_are_rejected);
+    RUN_TEST(test_matches_linear_scan_on_mutations);
+    return UNITY_END();
+}
@@ -0,0 +1,127 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "Param.h"
+
+// Concurrency of the param seqlock: each writer batches its own block of parameters to one
+// value, readers must never see a block that mixes two batches. Any consecutive parameters will
+// do in a test process.
+#define BLOCK_FIRST Param::u1
+#define BLOCK_COUNT 12
+#define RUN_MS      300
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void writeBlock(int value, int block = 0) {
+    Param::BeginBatch();
+    for (int i = 0; i < BLOCK_COUNT; i++) {
+        Param::SetInt(static_cast<Param::PARAM_NUM>(BLOCK_FIRST + block * BLOCK_COUNT + i), value);
+    }
+    Param::EndBatch();
+}
+
+static bool sameValues(const float* v) {
+    for (int i = 1; i < BLOCK_COUNT; i++) {
+        if (v[i] != v[0]) return false;
+    }
+    return true;
+}
+
+static bool blockConsistent(uint32_t& seq) {
+    float v[BLOCK_COUNT];
+    seq = Param::ReadFloats(BLOCK_FIRST, BLOCK_COUNT, v);
+    return sameValues(v);
+}
+
+static void test_readers_never_see_a_torn_batch(void) {
+    std::atomic<bool> run(true);
+    std::atomic<uint32_t> batches(0), reads(0), torn(0), backwards(0);
+
+    auto writer = [&](int block) {
+        int value = 0;
+        while (run.load()) {
+            writeBlock(value, block);
+            value = (value + 1) % 1000;
+            batches++;
+        }
+    };
+    auto reader = [&]() {
+        uint32_t last = 0;
+        float v[2 * BLOCK_COUNT];
+        while (run.load()) {
+            uint32_t seq = Param::ReadFloats(BLOCK_FIRST, 2 * BLOCK_COUNT, v);
+            if (!sameValues(v) || !sameValues(v + BLOCK_COUNT)) torn++;
+            // Sequence numbers of consistent copies never go back
+            if ((int32_t)(seq - last) < 0) backwards++;
+            last = seq;
+            reads++;
+        }
+    };
+
+    // Two writers with overlapping batches on different parameters, as the main loop and the
+    // serial task have
+    std::thread w1(writer, 0), w2(writer, 1), r1(reader), r2(reader);
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    run = false;
+    w1.join();
+    w2.join();
+    r1.join();
+    r2.join();
+
+    TEST_ASSERT_GREATER_THAN(0, batches.load());
+    TEST_ASSERT_GREATER_THAN(0, reads.load());
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, backwards.load());
+}
+
+// A reader waits for an open batch to close and then sees all of it
+static void test_reader_waits_for_open_batch(void) {
+    writeBlock(1);
+    std::atomic<bool> done(false);
+    float v[BLOCK_COUNT] = {0};
+
+    Param::BeginBatch();
+    for (int i = 0; i < BLOCK_COUNT / 2; i++) {
+        Param::SetInt(static_cast<Param::PARAM_NUM>(BLOCK_FIRST + i), 2);
+    }
+    std::thread r([&]() {
+        Param::ReadFloats(BLOCK_FIRST, BLOCK_COUNT, v);
+        done = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    TEST_ASSERT_FALSE(done.load());
+    for (int i = BLOCK_COUNT / 2; i < BLOCK_COUNT; i++) {
+        Param::SetInt(static_cast<Param::PARAM_NUM>(BLOCK_FIRST + i), 2);
+    }
+    Param::EndBatch();
+    r.join();
+
+    TEST_ASSERT_TRUE(done.load());
+    for (int i = 0; i < BLOCK_COUNT; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(2.0f, v[i]);
+    }
+}
+
+// Nested batches publish only when the outermost one ends
+static void test_nested_batches_publish_once(void) {
+    uint32_t before, after;
+    writeBlock(5);
+    blockConsistent(before);
+    Param::BeginBatch();
+    writeBlock(6);
+    Param::SetInt(BLOCK_FIRST, 7);
+    Param::EndBatch();
+    TEST_ASSERT_TRUE(blockConsistent(after) == false);   // the outer batch wrote a mixed block
+    TEST_ASSERT_EQUAL_UINT32(before + 2, after);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_readers_never_see_a_torn_batch);
+    RUN_TEST(test_reader_waits_for_open_batch);
+    RUN_TEST(test_nested_batches_publish_once);
+    return UNITY_END();
+}
@@ -0,0 +1,150 @@
+#include <unity.h>
+#include <string.h>
+#include "ParamStore.h"
+
+// The store runs against the in-memory backend; in a test process the persisted parameters
+// have no other reader, so the real registry rows are used directly.
+#define PERSISTED 19    // entries in PARAM_PERSIST_LIST
+
+// Fails every save while failSaves is set, to exercise the retry path
+class FlakyBackend : public MemoryParamBackend {
+public:
+    bool failSaves = false;
+    bool save(const char* key, const void* data, size_t len) override {
+        return !failSaves && MemoryParamBackend::save(key, data, len);
+    }
+};
+
+static MemoryParamBackend mem;
+static uint32_t t;
+
+void setUp(void) {
+    mem.erase();
+    mem.saves = 0;
+    t = 0;
+    Param::SetInt(Param::BalHys, 20);
+    Param::SetFloat(Param::capacity, 220.0f);
+    ParamStore::begin(mem);
+}
+
+void tearDown(void) {}
+
+static void test_first_commit_writes_every_key_once(void) {
+    TEST_ASSERT_TRUE(ParamStore::flush());
+    TEST_ASSERT_EQUAL_UINT32(PERSISTED, mem.saves);
+    TEST_ASSERT_TRUE(ParamStore::flush());
+    TEST_ASSERT_EQUAL_UINT32(PERSISTED, mem.saves);
+}
+
+static void test_changes_coalesce_after_quiet_period(void) {
+    ParamStore::flush();
+    uint32_t before = mem.saves;
+
+    Param::SetInt(Param::BalHys, 30);
+    ParamStore::loop(t += 100);
+    Param::SetInt(Param::BalHys, 31);
+    ParamStore::loop(t += 100);
+    Param::SetInt(Param::BalHys, 30);
+    ParamStore::loop(t += 100);
+    // Quiet period counts from the loop that saw the last change
+    ParamStore::loop(t += PARAM_STORE_QUIET_MS - 1);
+    TEST_ASSERT_EQUAL_UINT32(before, mem.saves);
+    ParamStore::loop(t += 1);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, mem.saves);
+    ParamStore::loop(t += PARAM_STORE_QUIET_MS);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, mem.saves);
+}
+
+static void test_steady_changes_commit_at_max_delay(void) {
+    ParamStore::flush();
+    uint32_t before = mem.saves;
+    uint32_t start = t;
+    int v = 40;
+    while (mem.saves == before && t - start <= 2 * PARAM_STORE_MAX_DELAY_MS) {
+        Param::SetInt(Param::BalHys, v++ % 2 ? 41 : 40);
+        ParamStore::loop(t += 1000);
+    }
+    TEST_ASSERT_EQUAL_UINT32(before + 1, mem.saves);
+    // The first change was seen by the first loop, one second in
+    TEST_ASSERT_EQUAL_UINT32(start + 1000 + PARAM_STORE_MAX_DELAY_MS, t);
+}
+
+static void test_reload_restores_committed_values(void) {
+    Param::SetInt(Param::BalHys, 77);
+    Param::SetFloat(Param::capacity, 105.5f);
+    ParamStore::flush();
+
+    Param::SetInt(Param::BalHys, 20);
+    Param::SetFloat(Param::capacity, 220.0f);
+    ParamStore::begin(mem);
+    TEST_ASSERT_EQUAL_INT(77, Param::GetInt(Param::BalHys));
+    TEST_ASSERT_EQUAL_FLOAT(105.5f, Param::GetFloat(Param::capacity));
+
+    // Loading is not a change: nothing is written back
+    uint32_t before = mem.saves;
+    ParamStore::loop(t += 2 * PARAM_STORE_MAX_DELAY_MS);
+    TEST_ASSERT_EQUAL_UINT32(before, mem.saves);
+}
+
+static void test_out_of_range_stored_value_is_dropped(void) {
+    int32_t tooBig = 5000;   // BalHys max is 500
+    mem.save("BalHys", &tooBig, sizeof(tooBig));
+    Param::SetInt(Param::BalHys, 25);
+    ParamStore::begin(mem);
+    TEST_ASSERT_EQUAL_INT(25, Param::GetInt(Param::BalHys));
+
+    // ... and replaced with the current value on the next commit
+    ParamStore::flush();
+    int32_t raw = 0;
+    TEST_ASSERT_TRUE(mem.load("BalHys", &raw, sizeof(raw)));
+    TEST_ASSERT_EQUAL_INT32(25, raw);
+}
+
+static void test_failed_write_is_retried(void) {
+    static FlakyBackend flaky;
+    flaky.erase();
+    ParamStore::begin(flaky);
+    ParamStore::loop(t += 1000);
+    flaky.failSaves = true;
+    TEST_ASSERT_FALSE(ParamStore::flush());
+
+    flaky.failSaves = false;
+    ParamStore::loop(t += PARAM_STORE_QUIET_MS - 1);
+    TEST_ASSERT_EQUAL_UINT32(0, flaky.saves);
+    ParamStore::loop(t += 1);
+    TEST_ASSERT_EQUAL_UINT32(PERSISTED, flaky.saves);
+}
+
+static void test_blobs(void) {
+    uint32_t in = 0xC0FFEE, out = 0;
+    TEST_ASSERT_TRUE(ParamStore::saveBlob("cc_test", &in, sizeof(in)));
+    TEST_ASSERT_TRUE(ParamStore::loadBlob("cc_test", &out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT32(in, out);
+    // Wrong length and parameter names are refused
+    uint16_t shortOut;
+    TEST_ASSERT_FALSE(ParamStore::loadBlob("cc_test", &shortOut, sizeof(shortOut)));
+    TEST_ASSERT_FALSE(ParamStore::saveBlob("numbmbs", &in, sizeof(in)));
+    TEST_ASSERT_FALSE(ParamStore::saveBlob("NUMBMBS", &in, sizeof(in)));
+}
+
+static void test_erase_forgets_stored_values(void) {
+    ParamStore::flush();
+    uint32_t before = mem.saves;
+    TEST_ASSERT_TRUE(ParamStore::erase());
+    // Everything is written again on the next commit
+    ParamStore::flush();
+    TEST_ASSERT_EQUAL_UINT32(before + PERSISTED, mem.saves);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_commit_writes_every_key_once);
+    RUN_TEST(test_changes_coalesce_after_quiet_period);
+    RUN_TEST(test_steady_changes_commit_at_max_delay);
+    RUN_TEST(test_reload_restores_committed_values);
+    RUN_TEST(test_out_of_range_stored_value_is_dropped);
+    RUN_TEST(test_failed_write_is_retried);
+    RUN_TEST(test_blobs);
+    RUN_TEST(test_erase_forgets_stored_values);
+    return UNITY_END();
+}